@@ -0,0 +1,589 @@
+// headless benchmark of the quadtree (insert, fetch_elements, fetch_elements_batch, fetch_nearest_elements, relocate_element, delete_element) on synthetic workloads
+#include <iostream>
+#include <vector>
+#include <string>
+#include <sstream>
+#include <random>
+#include <chrono>
+#include <algorithm>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <memory>
+
+#include <sys/resource.h>	// getrusage (peak memory)
+
+#include "quadtree.h"
+
+// half width of the root node and of the region the elements are placed in
+const float rootDim = 1000.0f;
+const float worldDim = 950.0f;
+
+// synthetic scene: points of all elements and the elements (iStart, iAmount)
+struct Scene
+{
+	std::vector<float> x;
+	std::vector<float> y;
+	std::vector< std::pair<int, int> > elements;
+
+	// mean distance between neighbouring elements
+	float spacing;
+};
+
+// latency distribution and throughput of a single operation
+struct OperationStats
+{
+	std::string name;
+	long long ops;
+	double opsPerSecond;
+	double p50;		// latency in microseconds
+	double p99;
+};
+
+// parameters of a benchmark run
+struct Settings
+{
+	std::vector<int> elementCounts = {1000, 10000, 100000};
+	std::vector<std::string> workloads = {"uniform", "clustered", "points", "polygons", "straddling"};
+	int ops = 100000;
+	unsigned int seed = 1;
+	unsigned int maxAmtElements = 1;
+	int maxDepth = 0;	// 0 -> chosen from the amount of elements
+	int mergeThreshold = -1;	// -1 -> split threshold
+	int gcInterval = 0;	// deferred merging: collect_garbage() every gcInterval relocations and deletions (0 -> immediate merging)
+	std::string storage = "shared";	// storage of the straddling elements: shared, enclosing or loose (see Quadtree::set_storage())
+	float looseness = 2.0f;	// loose storage: factor by which the nodes are enlarged
+	bool exactOverlap = false;	// shared storage: route the elements by their polygon (see Quadtree::set_exact_overlap())
+	std::vector<int> batchThreads;	// fetch_elements_batch: thread counts to measure (empty -> not measured)
+	int batchSize = 1024;	// fetch_elements_batch: queries per call
+};
+
+// add a polygon (amtVertices vertices on a jittered circle) to the scene
+void add_polygon(Scene &scene, std::mt19937 &rng, float cx, float cy, float radius, int amtVertices)
+{
+	std::uniform_real_distribution<float> jitter(0.5f, 1.0f);
+
+	scene.elements.push_back(std::make_pair((int)scene.x.size(), amtVertices));
+
+	for (int i = 0; i < amtVertices; i++)
+	{
+		float angle = 2.0f*M_PI*i/amtVertices;
+		float r = (amtVertices == 1) ? 0.0f : radius*jitter(rng);
+
+		scene.x.push_back(std::min(worldDim, std::max(-worldDim, cx + r*std::cos(angle))));
+		scene.y.push_back(std::min(worldDim, std::max(-worldDim, cy + r*std::sin(angle))));
+	}
+}
+
+// generate the elements of a workload
+//	uniform:    small polygons (3-6 vertices) distributed uniformly
+//	clustered:  small polygons (3-6 vertices) concentrated in a few gaussian clusters
+//	points:     single vertices distributed uniformly
+//	polygons:   large polygons (64 vertices) distributed uniformly
+//	straddling: rectangles larger than the leaf nodes, i.e., most elements reside in the shared space
+Scene generate_scene(const std::string &workload, int amtElements, unsigned int seed)
+{
+	Scene scene;
+	scene.spacing = 2.0f*worldDim/std::sqrt((float)amtElements);
+
+	std::mt19937 rng(seed);
+	std::uniform_real_distribution<float> position(-worldDim, worldDim);
+	std::uniform_int_distribution<int> smallVertices(3, 6);
+
+	if (workload == "clustered")
+	{
+		int amtClusters = std::max(4, (int)std::sqrt((float)amtElements)/10);
+		std::vector< std::pair<float, float> > clusters;
+
+		for (int i = 0; i < amtClusters; i++)
+		{
+			clusters.push_back(std::make_pair(position(rng), position(rng)));
+		}
+
+		std::normal_distribution<float> offset(0.0f, worldDim/20.0f);
+		std::uniform_int_distribution<int> pickCluster(0, amtClusters-1);
+
+		for (int i = 0; i < amtElements; i++)
+		{
+			auto &c = clusters[pickCluster(rng)];
+			add_polygon(scene, rng, c.first + offset(rng), c.second + offset(rng), 0.25f*scene.spacing, smallVertices(rng));
+		}
+	}
+	else if (workload == "points")
+	{
+		for (int i = 0; i < amtElements; i++)
+		{
+			add_polygon(scene, rng, position(rng), position(rng), 0.0f, 1);
+		}
+	}
+	else if (workload == "polygons")
+	{
+		for (int i = 0; i < amtElements; i++)
+		{
+			add_polygon(scene, rng, position(rng), position(rng), scene.spacing, 64);
+		}
+	}
+	else if (workload == "straddling")
+	{
+		for (int i = 0; i < amtElements; i++)
+		{
+			add_polygon(scene, rng, position(rng), position(rng), 2.0f*scene.spacing, 4);
+		}
+	}
+	else	// uniform
+	{
+		for (int i = 0; i < amtElements; i++)
+		{
+			add_polygon(scene, rng, position(rng), position(rng), 0.25f*scene.spacing, smallVertices(rng));
+		}
+	}
+
+	return scene;
+}
+
+// throughput and latency percentiles from the latencies (in nanoseconds) of single operations
+OperationStats evaluate(const std::string &name, std::vector<double> &latencies, double totalSeconds)
+{
+	OperationStats stats;
+	stats.name = name;
+	stats.ops = latencies.size();
+	stats.opsPerSecond = (totalSeconds > 0.0) ? latencies.size()/totalSeconds : 0.0;
+	stats.p50 = 0.0;
+	stats.p99 = 0.0;
+
+	if (latencies.empty() == false)
+	{
+		std::size_t i50 = latencies.size()/2;
+		std::size_t i99 = std::min(latencies.size()-1, (std::size_t)(0.99*latencies.size()));
+
+		std::nth_element(latencies.begin(), latencies.begin()+i50, latencies.end());
+		stats.p50 = latencies[i50]*1e-3;
+
+		std::nth_element(latencies.begin(), latencies.begin()+i99, latencies.end());
+		stats.p99 = latencies[i99]*1e-3;
+	}
+
+	return stats;
+}
+
+// run operation(i) for all i in indices and measure every single call
+template <typename Operation>
+OperationStats measure(const std::string &name, const std::vector<int> &indices, Operation operation)
+{
+	typedef std::chrono::steady_clock Clock;
+
+	std::vector<double> latencies;
+	latencies.reserve(indices.size());
+
+	Clock::time_point start = Clock::now();
+
+	for (int i : indices)
+	{
+		Clock::time_point t0 = Clock::now();
+		operation(i);
+		Clock::time_point t1 = Clock::now();
+
+		latencies.push_back(std::chrono::duration<double, std::nano>(t1-t0).count());
+	}
+
+	double totalSeconds = std::chrono::duration<double>(Clock::now()-start).count();
+
+	return evaluate(name, latencies, totalSeconds);
+}
+
+// peak resident memory of the process (in MiB)
+double peak_memory()
+{
+	struct rusage usage;
+	getrusage(RUSAGE_SELF, &usage);
+
+	return usage.ru_maxrss/1024.0;	// ru_maxrss is given in KiB
+}
+
+// run all operations of a workload on a tree of amtElements elements (treeStats: counters of the tree, see Quadtree::stats())
+std::vector<OperationStats> run_workload(const std::string &workload, int amtElements, const Settings &settings, QuadtreeStats &treeStats)
+{
+	Scene scene = generate_scene(workload, amtElements, settings.seed);
+
+	// default depth: about one element (times the split threshold) per leaf node
+	int maxDepth = settings.maxDepth;
+
+	if (maxDepth == 0)
+	{
+		maxDepth = 1;
+
+		while ((maxDepth < 16) and ((double)settings.maxAmtElements*std::pow(4.0, maxDepth) < amtElements))
+		{
+			maxDepth++;
+		}
+	}
+
+	Quadtree tree(std::make_shared<BoundaryBox>(0.0f, 0.0f, rootDim), nullptr, 0, &scene.x, &scene.y, settings.maxAmtElements, maxDepth);
+
+	if (settings.mergeThreshold >= 0)
+	{
+		tree.set_merge_threshold(settings.mergeThreshold);
+	}
+
+	tree.set_deferred_merging(settings.gcInterval > 0);
+	tree.set_exact_overlap(settings.exactOverlap);
+
+	if (settings.storage == "enclosing")
+	{
+		tree.set_storage(QUADTREE_STORAGE_ENCLOSING);
+	}
+	else if (settings.storage == "loose")
+	{
+		tree.set_storage(QUADTREE_STORAGE_LOOSE, settings.looseness);
+	}
+
+	// deferred merging: the cost of collect_garbage() is attributed to the operation which triggers it
+	int pendingOps = 0;
+
+	auto collect_garbage = [&]()
+	{
+		if ((settings.gcInterval > 0) and (++pendingOps == settings.gcInterval))
+		{
+			tree.collect_garbage();
+			pendingOps = 0;
+		}
+	};
+
+	std::mt19937 rng(settings.seed+1);
+
+	// all elements in the order of insertion and a random subset for the remaining operations
+	std::vector<int> all(amtElements);
+
+	for (int i = 0; i < amtElements; i++)
+	{
+		all[i] = i;
+	}
+
+	std::vector<int> subset = all;
+	std::shuffle(subset.begin(), subset.end(), rng);
+	subset.resize(std::min(amtElements, settings.ops));
+
+	std::vector<OperationStats> results;
+
+	// insert
+	results.push_back(measure("insert", all, [&](int i)
+	{
+		tree.insert(scene.elements[i].first, scene.elements[i].second);
+	}));
+
+	// fetch_elements (the buffer is reused, i.e., the allocation free overload)
+	std::vector< std::pair<int, int> > found;
+	long long amtFound = 0;
+
+	results.push_back(measure("fetch_elements", subset, [&](int i)
+	{
+		found.clear();
+		tree.fetch_elements(scene.elements[i].first, scene.elements[i].second, found);
+		amtFound += found.size();
+	}));
+
+	// fetch_elements_batch (ops/s: queries per second, latency: per call of batchSize queries). The worker threads are started by the first call and reused by the following ones.
+	std::vector< std::vector< std::pair<int, int> > > batchResults;
+
+	for (int threadCount : settings.batchThreads)
+	{
+		std::vector<int> batches;
+
+		for (int first = 0; first < (int)subset.size(); first += settings.batchSize)
+		{
+			batches.push_back(first);
+		}
+
+		std::vector< std::pair<int, int> > queries;
+
+		OperationStats stats = measure("fetch_batch/" + std::to_string(threadCount), batches, [&](int first)
+		{
+			queries.clear();
+
+			for (int i = first; i < std::min(first+settings.batchSize, (int)subset.size()); i++)
+			{
+				queries.push_back(scene.elements[subset[i]]);
+			}
+
+			tree.fetch_elements_batch(queries, batchResults, threadCount);
+			amtFound += batchResults.size();
+		});
+
+		stats.opsPerSecond *= (stats.ops > 0) ? (double)subset.size()/stats.ops : 0.0;
+		stats.ops = subset.size();
+
+		results.push_back(stats);
+	}
+
+	// fetch_nearest_elements (the 8 elements closest to the first point of an element)
+	std::vector<NearestElement> nearest;
+
+	results.push_back(measure("fetch_nearest", subset, [&](int i)
+	{
+		tree.fetch_nearest_elements(scene.x[scene.elements[i].first], scene.y[scene.elements[i].first], 8, nearest);
+		amtFound += nearest.size();
+	}));
+
+	// relocate_element (small steps of a quarter of the spacing). Elements leaving the root node are removed from the tree.
+	std::vector<char> inTree(amtElements, 1);
+	std::vector<float> newX;
+	std::vector<float> newY;
+	std::uniform_real_distribution<float> step(-0.25f*scene.spacing, 0.25f*scene.spacing);
+
+	results.push_back(measure("relocate_element", subset, [&](int i)
+	{
+		int iStart = scene.elements[i].first;
+		int iAmount = scene.elements[i].second;
+		float dx = step(rng);
+		float dy = step(rng);
+
+		newX.resize(iAmount);
+		newY.resize(iAmount);
+
+		for (int k = 0; k < iAmount; k++)
+		{
+			newX[k] = scene.x[iStart+k] + dx;
+			newY[k] = scene.y[iStart+k] + dy;
+		}
+
+		inTree[i] = tree.relocate_element(iStart, iAmount, &newX, &newY);
+		collect_garbage();
+	}));
+
+	// delete_element
+	std::vector<int> remove;
+
+	for (int i : subset)
+	{
+		if (inTree[i])
+		{
+			remove.push_back(i);
+		}
+	}
+
+	results.push_back(measure("delete_element", remove, [&](int i)
+	{
+		tree.delete_element(scene.elements[i].first, scene.elements[i].second);
+		collect_garbage();
+	}));
+
+	treeStats = tree.stats();
+
+	// keep the query results alive (prevents the compiler from removing the queries)
+	if (amtFound < 0)
+	{
+		std::cout << amtFound << std::endl;
+	}
+
+	return results;
+}
+
+// parse a comma separated list
+std::vector<std::string> split_list(const std::string &list)
+{
+	std::vector<std::string> items;
+	std::stringstream stream(list);
+	std::string item;
+
+	while (std::getline(stream, item, ','))
+	{
+		if (item.empty() == false)
+		{
+			items.push_back(item);
+		}
+	}
+
+	return items;
+}
+
+void print_usage(const char *program)
+{
+	std::cout << "usage: " << program << " [options]" << std::endl;
+	std::cout << "  --elements N[,N...]   amount of elements (1000 ... 10000000, default: 1000,10000,100000)" << std::endl;
+	std::cout << "  --workloads W[,W...]  uniform, clustered, points, polygons, straddling or all (default: all)" << std::endl;
+	std::cout << "  --ops N               amount of measured queries, relocations and deletions (default: 100000)" << std::endl;
+	std::cout << "  --split N             split threshold of the nodes (default: 1)" << std::endl;
+	std::cout << "  --depth N             maximum depth of the tree (default: chosen from the amount of elements)" << std::endl;
+	std::cout << "  --merge N             merge threshold of the nodes (0 ... split threshold, default: split threshold)" << std::endl;
+	std::cout << "  --gc-interval N       deferred merging: collect the garbage every N relocations and deletions (default: 0, immediate merging)" << std::endl;
+	std::cout << "  --storage S           storage of the straddling elements: shared, enclosing or loose (default: shared)" << std::endl;
+	std::cout << "  --loose F             loose storage: enlarge the nodes by the factor F (>= 1, default: 2), implies --storage loose" << std::endl;
+	std::cout << "  --exact-overlap 0|1   shared storage: route the elements by their polygon instead of their AABB (default: 0)" << std::endl;
+	std::cout << "  --batch-threads N[,N] measure fetch_elements_batch with N threads (default: not measured)" << std::endl;
+	std::cout << "  --batch-size N        queries per call of fetch_elements_batch (default: 1024)" << std::endl;
+	std::cout << "  --seed N              seed of the workloads (default: 1)" << std::endl;
+}
+
+int main(int argc, char *argv[])
+{
+	Settings settings;
+
+	for (int i = 1; i < argc; i++)
+	{
+		std::string arg = argv[i];
+
+		if ((arg == "--help") or (arg == "-h"))
+		{
+			print_usage(argv[0]);
+			return 0;
+		}
+
+		if (i+1 >= argc)
+		{
+			print_usage(argv[0]);
+			return 1;
+		}
+
+		std::string value = argv[++i];
+
+		if (arg == "--elements")
+		{
+			settings.elementCounts.clear();
+
+			for (const std::string &item : split_list(value))
+			{
+				settings.elementCounts.push_back(std::atoi(item.c_str()));
+			}
+		}
+		else if (arg == "--workloads")
+		{
+			if (value != "all")
+			{
+				settings.workloads = split_list(value);
+			}
+		}
+		else if (arg == "--ops")
+		{
+			settings.ops = std::atoi(value.c_str());
+		}
+		else if (arg == "--split")
+		{
+			settings.maxAmtElements = std::atoi(value.c_str());
+		}
+		else if (arg == "--depth")
+		{
+			settings.maxDepth = std::atoi(value.c_str());
+		}
+		else if (arg == "--merge")
+		{
+			settings.mergeThreshold = std::atoi(value.c_str());
+		}
+		else if (arg == "--gc-interval")
+		{
+			settings.gcInterval = std::atoi(value.c_str());
+		}
+		else if (arg == "--storage")
+		{
+			settings.storage = value;
+		}
+		else if (arg == "--loose")
+		{
+			settings.storage = "loose";
+			settings.looseness = std::atof(value.c_str());
+		}
+		else if (arg == "--exact-overlap")
+		{
+			settings.exactOverlap = (std::atoi(value.c_str()) != 0);
+		}
+		else if (arg == "--batch-threads")
+		{
+			settings.batchThreads.clear();
+
+			for (const std::string &item : split_list(value))
+			{
+				settings.batchThreads.push_back(std::atoi(item.c_str()));
+			}
+		}
+		else if (arg == "--batch-size")
+		{
+			settings.batchSize = std::atoi(value.c_str());
+		}
+		else if (arg == "--seed")
+		{
+			settings.seed = std::atoi(value.c_str());
+		}
+		else
+		{
+			print_usage(argv[0]);
+			return 1;
+		}
+	}
+
+	for (int amtElements : settings.elementCounts)
+	{
+		if ((amtElements < 1) or (amtElements > 10000000))
+		{
+			std::cout << "amount of elements has to be in 1 ... 10000000" << std::endl;
+			return 1;
+		}
+	}
+
+	if ((settings.mergeThreshold > (int)settings.maxAmtElements) or (settings.gcInterval < 0))
+	{
+		std::cout << "merge threshold has to be in 0 ... split threshold, gc interval has to be positive" << std::endl;
+		return 1;
+	}
+
+	if ((settings.storage != "shared") and (settings.storage != "enclosing") and (settings.storage != "loose"))
+	{
+		std::cout << "unknown storage: " << settings.storage << std::endl;
+		return 1;
+	}
+
+	if (settings.exactOverlap and (settings.storage != "shared"))
+	{
+		std::cout << "exact overlap tests require the shared storage" << std::endl;
+		return 1;
+	}
+
+	if ((settings.batchSize < 1) or std::any_of(settings.batchThreads.begin(), settings.batchThreads.end(), [](int threadCount) { return threadCount < 1; }))
+	{
+		std::cout << "batch size and batch threads have to be positive" << std::endl;
+		return 1;
+	}
+
+	if (settings.looseness < 1.0f)
+	{
+		std::cout << "looseness has to be at least 1" << std::endl;
+		return 1;
+	}
+
+	const std::vector<std::string> knownWorkloads = {"uniform", "clustered", "points", "polygons", "straddling"};
+
+	for (const std::string &workload : settings.workloads)
+	{
+		if (std::find(knownWorkloads.begin(), knownWorkloads.end(), workload) == knownWorkloads.end())
+		{
+			std::cout << "unknown workload: " << workload << std::endl;
+			return 1;
+		}
+	}
+
+	std::printf("%-11s %9s %-17s %9s %13s %10s %10s %12s\n", "workload", "elements", "operation", "ops", "ops/s", "p50 [us]", "p99 [us]", "peak [MiB]");
+
+	for (const std::string &workload : settings.workloads)
+	{
+		for (int amtElements : settings.elementCounts)
+		{
+			QuadtreeStats treeStats;
+			std::vector<OperationStats> results = run_workload(workload, amtElements, settings, treeStats);
+
+			// peak memory of the process so far (run a single workload to isolate its memory)
+			double peak = peak_memory();
+
+			for (const OperationStats &stats : results)
+			{
+				std::printf("%-11s %9d %-17s %9lld %13.0f %10.2f %10.2f %12.1f\n", workload.c_str(), amtElements, stats.name.c_str(), stats.ops, stats.opsPerSecond, stats.p50, stats.p99, peak);
+			}
+
+#ifdef QUADTREE_STATS
+			// counters of the tree (library built with QUADTREE_STATS)
+			std::printf("  node visits/query %.1f, subdivisions %llu, merges %llu, shared inserts %llu, remove scan length %.1f\n",
+				(double)treeStats.nodeVisits/std::max<uint64_t>(1, treeStats.queries), (unsigned long long)treeStats.subdivisions, (unsigned long long)treeStats.merges,
+				(unsigned long long)treeStats.sharedInserts, (double)treeStats.removeScanLength/std::max<uint64_t>(1, treeStats.removeScans));
+#endif
+		}
+	}
+
+	return 0;
+}
@@ -0,0 +1,506 @@
+// linear (pointerless) quadtree class & functions
+#include <math.h>
+#include <iostream>
+#include <vector>
+#include <algorithm>	// std::min, std::max, std::upper_bound
+#include <tuple>
+#include <limits>
+
+#include "linear_quadtree.h"
+#include "quadtree_kernels.h"
+
+
+// constructor
+LinearQuadtree::LinearQuadtree(std::shared_ptr<BoundaryBox> BB_init, std::vector<float> *iVecX, std::vector<float> *iVecY, unsigned int _maxAmtElements, int _maxDepth) : boundary2(*BB_init)
+{
+	if ((_maxAmtElements < 1) or (_maxDepth < 0) or (_maxDepth > 16))
+	{
+		std::cout << "LinearQuadtree -> invalid split threshold or maximum depth" << std::endl;
+		exit(1);
+	}
+
+	maxAmtElements = _maxAmtElements;
+	maxDepth = _maxDepth;
+
+	// Provide pointer to the std::vector containing all the points.
+	ptrToX = iVecX;
+	ptrToY = iVecY;
+
+	dirty = true;
+}
+
+// grid coordinate (cell of the finest grid) of a coordinate
+uint32_t LinearQuadtree::grid_coordinate(float v, float lowerBound) const
+{
+	int gridSize = 1 << maxDepth;
+
+	// a cell i covers (lowerBound + i*width, lowerBound + (i+1)*width]
+	double t = ((double)v - (double)lowerBound) / (2.0*(double)boundary2.dim) * gridSize;
+	double cell = ceil(t) - 1.0;
+
+	if (cell < 0.0)
+	{
+		return 0;
+	}
+
+	if (cell > gridSize-1)
+	{
+		return gridSize-1;
+	}
+
+	return (uint32_t)cell;
+}
+
+// bounds of an interval for the overlap tests of the leaf nodes
+void LinearQuadtree::overlap_bounds(float vmin, float vmax, float lowerBound, int &first, int &last) const
+{
+	int gridSize = 1 << maxDepth;
+
+	// a leaf covering the cells [g, g+size-1] overlaps if vmin < lowerBound + (g+size)*width and vmax > lowerBound + g*width
+	double tmin = ((double)vmin - (double)lowerBound) / (2.0*(double)boundary2.dim) * gridSize;
+	double tmax = ((double)vmax - (double)lowerBound) / (2.0*(double)boundary2.dim) * gridSize;
+
+	first = (int)std::min(std::max(floor(tmin), -1.0), (double)gridSize);
+	last  = (int)std::min(std::max(ceil(tmax) - 1.0, -1.0), (double)gridSize);
+
+	// an interval of zero width only overlaps the leaf node containing it (same as BoundaryBox::overlaps)
+	if (vmin == vmax)
+	{
+		first = last;
+	}
+}
+
+// the AABB of the element overlaps the interior of the leaf node
+bool LinearQuadtree::overlaps_cell(const LinearQuadtreeCell &c, const GridElement &e)
+{
+	return ((int)c.gx <= e.oxmax) and ((int)(c.gx+c.size-1) >= e.oxmin) and ((int)c.gy <= e.oymax) and ((int)(c.gy+c.size-1) >= e.oymin);
+}
+
+// interleave the bits of the grid coordinates (x -> even bits, y -> odd bits)
+uint32_t LinearQuadtree::morton_code(uint32_t gx, uint32_t gy)
+{
+	uint32_t code = 0;
+
+	for (int i = 0; i < 16; i++)
+	{
+		code |= ((gx >> i) & 1u) << (2*i);
+		code |= ((gy >> i) & 1u) << (2*i+1);
+	}
+
+	return code;
+}
+
+// generate a AABB-boundary box (defined by xmin, xmax, ymin, ymax)
+std::tuple<float, float, float, float> LinearQuadtree::genAABBBox(int iStart, int iAmount)
+{
+	float xmin, xmax, ymin, ymax;
+	points_AABB(ptrToX->data()+iStart, ptrToY->data()+iStart, iAmount, xmin, xmax, ymin, ymax);
+
+	return std::make_tuple(xmin, xmax, ymin, ymax);
+}
+
+// convert the AABB boundary box of an element into grid coordinates. Returns true if the element fits completely into the root node.
+bool LinearQuadtree::grid_box(const std::tuple<float, float, float, float> &aabb, GridElement &e)
+{
+	float xmin = std::get<0>(aabb);
+	float xmax = std::get<1>(aabb);
+	float ymin = std::get<2>(aabb);
+	float ymax = std::get<3>(aabb);
+
+	e.gxmin = grid_coordinate(xmin, boundary2.cx-boundary2.dim);
+	e.gxmax = grid_coordinate(xmax, boundary2.cx-boundary2.dim);
+	e.gymin = grid_coordinate(ymin, boundary2.cy-boundary2.dim);
+	e.gymax = grid_coordinate(ymax, boundary2.cy-boundary2.dim);
+
+	overlap_bounds(xmin, xmax, boundary2.cx-boundary2.dim, e.oxmin, e.oxmax);
+	overlap_bounds(ymin, ymax, boundary2.cy-boundary2.dim, e.oymin, e.oymax);
+
+	return (xmin > boundary2.cx-boundary2.dim) and (xmax <= boundary2.cx+boundary2.dim) and (ymin > boundary2.cy-boundary2.dim) and (ymax <= boundary2.cy+boundary2.dim);
+}
+
+// amount of points of an element residing inside the root node
+int LinearQuadtree::count_inside(int iStart, int iAmount, const std::vector<float> *vecX, const std::vector<float> *vecY)
+{
+	return count_points_inside(vecX->data()+iStart, vecY->data()+iStart, iAmount, boundary2.cx-boundary2.dim, boundary2.cx+boundary2.dim, boundary2.cy-boundary2.dim, boundary2.cy+boundary2.dim);
+}
+
+// the element is stored by Quadtree::insert()
+bool LinearQuadtree::accepts(int iStart, int iAmount)
+{
+	auto returnAABB = genAABBBox(iStart, iAmount);
+	float xmin = std::get<0>(returnAABB);
+	float xmax = std::get<1>(returnAABB);
+	float ymin = std::get<2>(returnAABB);
+	float ymax = std::get<3>(returnAABB);
+
+	GridElement e;
+
+	if (grid_box(returnAABB, e) == true)
+	{
+		return true;
+	}
+
+	// Quadtree::insert() copies the element into the leaf nodes overlapping it, starting at the root node
+	return boundary2.overlaps(xmin, xmax, ymin, ymax) and (count_inside(iStart, iAmount, ptrToX, ptrToY) > 0);
+}
+
+// index of the first leaf node (in cells[firstCell, lastCell)) which may overlap the grid box with the lower left corner (gxmin, gymin)
+int LinearQuadtree::first_cell(uint32_t gxmin, uint32_t gymin, int firstCell, int lastCell)
+{
+	uint32_t codeMin = morton_code(gxmin, gymin);
+
+	// last leaf node starting at or before codeMin
+	auto it = std::upper_bound(cells.begin()+firstCell, cells.begin()+lastCell, codeMin, [](uint32_t code, const LinearQuadtreeCell &c) { return code < c.code; });
+
+	if (it == cells.begin()+firstCell)
+	{
+		return firstCell;
+	}
+
+	return (it - cells.begin()) - 1;
+}
+
+// all leaf nodes overlapping the element lie between the leaf nodes of the lower left and the upper right cell of the element (clamped to the grid)
+int LinearQuadtree::first_overlapping_cell(const GridElement &e, int firstCell, int lastCell)
+{
+	int gridMax = (1 << maxDepth) - 1;
+
+	return first_cell(std::min(std::max(std::min(e.oxmin, e.oxmax), 0), gridMax), std::min(std::max(std::min(e.oymin, e.oymax), 0), gridMax), firstCell, lastCell);
+}
+
+uint32_t LinearQuadtree::last_overlapping_code(const GridElement &e) const
+{
+	int gridMax = (1 << maxDepth) - 1;
+
+	return morton_code(std::min(std::max(std::max(e.oxmin, e.oxmax), 0), gridMax), std::min(std::max(std::max(e.oymin, e.oymax), 0), gridMax));
+}
+
+// add an element to the shared space of all leaf nodes in cells[firstCell, lastCell) which overlap the element (same as Quadtree: the AABB has to overlap the interior of the leaf node)
+void LinearQuadtree::insert_shared(const GridElement &e, int firstCell, int lastCell, std::vector<CellEntry> &entries)
+{
+	uint32_t codeMax = last_overlapping_code(e);
+
+	for (int i = first_overlapping_cell(e, firstCell, lastCell); (i < lastCell) and (cells[i].code <= codeMax); i++)
+	{
+		if (overlaps_cell(cells[i], e))
+		{
+			entries.push_back({i, 1, e.iStart, e.iAmount});
+		}
+	}
+}
+
+// auxiliary function used by rebuild(). Sorts the elements elements[first, last) (which all fit completely into the node (depth, nx, ny)) into leaf nodes
+void LinearQuadtree::rebuild_internal(int depth, uint32_t nx, uint32_t ny, std::vector<GridElement> &elements, std::vector<GridElement> &scratch, int first, int last, std::vector<CellEntry> &entries)
+{
+	int shift = maxDepth - depth;
+
+	// leaf node (same rule as in Quadtree::insert())
+	if (((unsigned int)(last-first) <= maxAmtElements) or (depth == maxDepth))
+	{
+		LinearQuadtreeCell c;
+		c.gx = nx << shift;
+		c.gy = ny << shift;
+		c.size = 1u << shift;
+		c.code = morton_code(c.gx, c.gy);
+
+		int cellIndex = cells.size();
+		cells.push_back(c);
+
+		for (int i = first; i < last; i++)
+		{
+			entries.push_back({cellIndex, 0, elements[i].iStart, elements[i].iAmount});
+		}
+
+		return;
+	}
+
+	// children in morton order (SW, SE, NW, NE). The last bucket holds the elements which do not fit into a single child node (shared space)
+	int childShift = shift - 1;
+
+	auto bucket_of = [childShift](const GridElement &e)
+	{
+		if (((e.gxmin >> childShift) == (e.gxmax >> childShift)) and ((e.gymin >> childShift) == (e.gymax >> childShift)))
+		{
+			return (int)(((e.gxmin >> childShift) & 1u) | (((e.gymin >> childShift) & 1u) << 1));
+		}
+
+		return 4;
+	};
+
+	int bucketStart[6] = {0, 0, 0, 0, 0, 0};
+
+	for (int i = first; i < last; i++)
+	{
+		bucketStart[bucket_of(elements[i])+1]++;
+	}
+
+	bucketStart[0] = first;
+
+	for (int k = 0; k < 5; k++)
+	{
+		bucketStart[k+1] += bucketStart[k];
+	}
+
+	// stable counting sort of elements[first, last) into the five buckets
+	int fill[5] = {bucketStart[0], bucketStart[1], bucketStart[2], bucketStart[3], bucketStart[4]};
+
+	for (int i = first; i < last; i++)
+	{
+		scratch[fill[bucket_of(elements[i])]++] = elements[i];
+	}
+
+	std::copy(scratch.begin()+first, scratch.begin()+last, elements.begin()+first);
+
+	int firstCell = cells.size();
+
+	for (int k = 0; k < 4; k++)
+	{
+		rebuild_internal(depth+1, (nx << 1) | (k & 1), (ny << 1) | (k >> 1), elements, scratch, bucketStart[k], bucketStart[k+1], entries);
+	}
+
+	// the leaf nodes of this node are complete -> move the shared elements into them
+	for (int i = bucketStart[4]; i < bucketStart[5]; i++)
+	{
+		insert_shared(elements[i], firstCell, cells.size(), entries);
+	}
+}
+
+// rebuild the leaf nodes from all elements stored in the tree
+void LinearQuadtree::rebuild()
+{
+	cells.clear();
+	cell_element_start.clear();
+	cell_element_amount.clear();
+
+	// elements residing completely inside the root node, and elements residing only partially inside the root node
+	std::vector<GridElement> inside;
+	std::vector<GridElement> sharedRoot;
+
+	inside.reserve(element_start.size());
+
+	for (int i = 0; i < (int)element_start.size(); i++)
+	{
+		GridElement e;
+		e.iStart = element_start[i];
+		e.iAmount = element_amount[i];
+
+		if (grid_box(genAABBBox(e.iStart, e.iAmount), e) == true)
+		{
+			inside.push_back(e);
+		}
+		else
+		{
+			sharedRoot.push_back(e);
+		}
+	}
+
+	std::vector<GridElement> scratch(inside.size());
+	std::vector<CellEntry> entries;
+
+	rebuild_internal(0, 0, 0, inside, scratch, 0, inside.size(), entries);
+
+	for (int i = 0; i < (int)sharedRoot.size(); i++)
+	{
+		insert_shared(sharedRoot[i], 0, cells.size(), entries);
+	}
+
+	// store the elements contiguously per leaf node (elements residing completely in the leaf first, then the shared elements)
+	std::vector<int> offset(2*cells.size()+1, 0);
+
+	for (int i = 0; i < (int)entries.size(); i++)
+	{
+		offset[2*entries[i].cell + entries[i].shared + 1]++;
+	}
+
+	for (int i = 0; i < 2*(int)cells.size(); i++)
+	{
+		offset[i+1] += offset[i];
+	}
+
+	for (int i = 0; i < (int)cells.size(); i++)
+	{
+		cells[i].elementBegin = offset[2*i];
+		cells[i].sharedBegin  = offset[2*i+1];
+		cells[i].elementEnd   = offset[2*i+2];
+	}
+
+	cell_element_start.resize(entries.size());
+	cell_element_amount.resize(entries.size());
+
+	for (int i = 0; i < (int)entries.size(); i++)
+	{
+		int pos = offset[2*entries[i].cell + entries[i].shared]++;
+
+		cell_element_start[pos]  = entries[i].iStart;
+		cell_element_amount[pos] = entries[i].iAmount;
+	}
+
+	dirty = false;
+}
+
+// insert an element into the tree
+bool LinearQuadtree::insert(int iStart, int iAmount)
+{
+	// object lies completely outside of the root node (or would reside in no leaf node, see accepts())
+	if (accepts(iStart, iAmount) == false)
+	{
+		return false;
+	}
+
+	element_index[iStart] = element_start.size();
+	element_start.push_back(iStart);
+	element_amount.push_back(iAmount);
+
+	dirty = true;
+
+	return true;
+}
+
+// replace all elements of the tree by the given elements (iStart, iAmount)
+bool LinearQuadtree::build(const std::vector< std::pair<int, int> > &elements)
+{
+	element_start.clear();
+	element_amount.clear();
+	element_index.clear();
+
+	bool allInserted = true;
+
+	for (int i = 0; i < (int)elements.size(); i++)
+	{
+		if (insert(elements[i].first, elements[i].second) == false)
+		{
+			allInserted = false;
+		}
+	}
+
+	rebuild();
+
+	return allInserted;
+}
+
+// remove a single element from the tree
+bool LinearQuadtree::delete_element(int iStart, int iAmount)
+{
+	auto it = element_index.find(iStart);
+
+	if ((it == element_index.end()) or (element_amount[it->second] != iAmount))
+	{
+		std::cout << "delete_element -> cant find element in the linear quadtree" << std::endl;
+		exit(1);
+	}
+
+	// move the last element into the gap
+	int pos = it->second;
+	int last = element_start.size()-1;
+
+	element_start[pos]  = element_start[last];
+	element_amount[pos] = element_amount[last];
+	element_index[element_start[pos]] = pos;
+
+	element_start.pop_back();
+	element_amount.pop_back();
+	element_index.erase(iStart);
+
+	dirty = true;
+
+	return true;
+}
+
+// relocate a single element
+bool LinearQuadtree::relocate_element(int iStartPreMovement, int iAmountPreMovement, const std::vector<float>* relocateNewCoordinatesx, const std::vector<float>* relocateNewCoordinatesy)
+{
+	// the points are only overwritten if they belong to an element of the tree
+	auto it = element_index.find(iStartPreMovement);
+
+	if ((it == element_index.end()) or (element_amount[it->second] != iAmountPreMovement))
+	{
+		std::cout << "relocate_element -> cant find element in the linear quadtree" << std::endl;
+		return false;
+	}
+
+	for (int i = iStartPreMovement; i < iStartPreMovement + iAmountPreMovement; i++)
+	{
+		(*ptrToX)[i] = (*relocateNewCoordinatesx)[i - iStartPreMovement];
+		(*ptrToY)[i] = (*relocateNewCoordinatesy)[i - iStartPreMovement];
+	}
+
+	dirty = true;
+
+	// element moved out of the qt
+	if (accepts(iStartPreMovement, iAmountPreMovement) == false)
+	{
+		delete_element(iStartPreMovement, iAmountPreMovement);
+		return false;
+	}
+
+	return true;
+}
+
+// returns all possible colliding elements corresponding to the leaf nodes which the AABB of this element (iStart, iAmount) overlaps
+std::set< std::pair<int,int> > LinearQuadtree::fetch_elements(int iStart, int iAmount)
+{
+	if (dirty == true)
+	{
+		rebuild();
+	}
+
+	std::set< std::pair<int, int> > vec;
+
+	// generate the AABB boundary box
+	auto returnAABB = genAABBBox(iStart, iAmount);
+	float xmin = std::get<0>(returnAABB);
+	float xmax = std::get<1>(returnAABB);
+	float ymin = std::get<2>(returnAABB);
+	float ymax = std::get<3>(returnAABB);
+
+	// the AABB does not overlap the root node
+	if (boundary2.overlaps(xmin, xmax, ymin, ymax) == false)
+	{
+		return vec;
+	}
+
+	GridElement e;
+	grid_box(returnAABB, e);
+
+	// contiguous scan of the leaf nodes between the morton codes of the lower left and the upper right corner (same overlap test as Quadtree, e.g., a point on the border of a leaf node overlaps none of the leaf nodes)
+	uint32_t codeMax = last_overlapping_code(e);
+
+	for (int i = first_overlapping_cell(e, 0, cells.size()); (i < (int)cells.size()) and (cells[i].code <= codeMax); i++)
+	{
+		const LinearQuadtreeCell &c = cells[i];
+
+		if (overlaps_cell(c, e))
+		{
+			for (int k = c.elementBegin; k < c.elementEnd; k++)
+			{
+				vec.insert(std::make_pair(cell_element_start[k], cell_element_amount[k]));
+			}
+		}
+	}
+
+	return vec;
+}
+
+// count the leaf nodes of the tree
+int LinearQuadtree::count_nodes()
+{
+	if (dirty == true)
+	{
+		rebuild();
+	}
+
+	return cells.size();
+}
+
+// count the elements residing in the leaf nodes of the tree
+int LinearQuadtree::count_elements()
+{
+	if (dirty == true)
+	{
+		rebuild();
+	}
+
+	std::set<int> residing(cell_element_start.begin(), cell_element_start.end());
+
+	return residing.size();
+}
@@ -0,0 +1,145 @@
+// linear (pointerless) quadtree header
+#ifndef __LINEAR_QUADTREE_H_INCLUDED__
+#define __LINEAR_QUADTREE_H_INCLUDED__
+
+#include <vector>
+#include <set>
+#include <unordered_map>
+#include <cstdint>
+#include <tuple>
+
+#include <memory>   // std::shared_ptr
+#include <utility>  // std::pair
+
+#include "quadtree.h"	// BoundaryBox, QUADTREE_MAX_ELEMENTS, QUADTREE_MAX_DEPTH
+
+// leaf node of the linear quadtree. The leaf covers a square of cells of the finest grid (2^maxDepth x 2^maxDepth cells).
+struct LinearQuadtreeCell
+{
+	uint32_t code;		// morton code of the first (lower left) cell of the finest grid covered by this leaf
+	uint32_t gx;		// grid coordinates of the lower left cell
+	uint32_t gy;
+	uint32_t size;		// width of the leaf (in cells of the finest grid)
+
+	// the elements of this leaf are stored in LinearQuadtree::cell_element_start/amount
+	int elementBegin;	// elements residing completely in this leaf: [elementBegin, sharedBegin)
+	int sharedBegin;	// elements in the shared space of this leaf: [sharedBegin, elementEnd)
+	int elementEnd;
+};
+
+// Quadtree without children pointers. The leaves are stored as an array sorted by their morton codes, i.e., locating a point is a binary search and a range query is a contiguous scan of this array. The leaves follow the rules of Quadtree (splitting rules, shared space). Designed for read-mostly data: insert, delete_element and relocate_element only mark the tree as modified, the leaf array is rebuilt by the next query.
+class LinearQuadtree
+{
+	private:
+		// dimensions of the root node
+		BoundaryBox boundary2;
+
+		// pointer to the std::vectors containing all the points
+		std::vector<float> *ptrToX;
+		std::vector<float> *ptrToY;
+
+		// minimum amount of pts to split the node
+		unsigned int maxAmtElements;
+
+		// maximum depth of the children nodes (the finest grid consists of 2^maxDepth x 2^maxDepth cells, i.e., at most 16 -> 32 bit morton codes)
+		int maxDepth;
+
+		// all elements stored in the tree
+		std::vector<int> element_start;
+		std::vector<int> element_amount;
+
+		// position of an element (key: iStart) in element_start and element_amount
+		std::unordered_map<int, int> element_index;
+
+		// leaf nodes sorted by their morton code
+		std::vector<LinearQuadtreeCell> cells;
+
+		// elements of all leaf nodes (contiguous per leaf node)
+		std::vector<int> cell_element_start;
+		std::vector<int> cell_element_amount;
+
+		// the leaf nodes have to be rebuilt before the next query
+		bool dirty;
+
+		// element (and its AABB in grid coordinates) which is sorted into the leaves by rebuild(). gxmin ... gymax: cells containing the corners of the AABB (decides into which node the element fits, see grid_coordinate()), oxmin ... oymax: bounds of the leaf nodes whose interior the AABB overlaps (see overlap_bounds() and overlaps_cell())
+		struct GridElement
+		{
+			uint32_t gxmin, gxmax, gymin, gymax;
+			int oxmin, oxmax, oymin, oymax;
+			int iStart, iAmount;
+		};
+
+		// element assigned to a leaf node by rebuild()
+		struct CellEntry
+		{
+			int cell;
+			int shared;
+			int iStart, iAmount;
+		};
+
+		// grid coordinate (cell of the finest grid) of a coordinate. The node boundaries are treated as in Quadtree, i.e., a point on the boundary belongs to the lower node.
+		uint32_t grid_coordinate(float v, float lowerBound) const;
+
+		// bounds of the interval [vmin, vmax] for the overlap tests of the leaf nodes: a leaf covering the cells [g, g+size-1] overlaps the interval if g <= last and g+size-1 >= first (same test as BoundaryBox::overlaps, i.e., an interval ending on the boundary of a leaf node does not overlap it, while an interval of zero width overlaps the leaf node (lower, upper] containing it). first: cell containing vmin (a coordinate on the boundary belongs to the upper cell), last: cell containing vmax (a coordinate on the boundary belongs to the lower cell), both in -1 ... 2^maxDepth.
+		void overlap_bounds(float vmin, float vmax, float lowerBound, int &first, int &last) const;
+
+		// the AABB of the element overlaps the interior of the leaf node (see overlap_bounds())
+		static bool overlaps_cell(const LinearQuadtreeCell &c, const GridElement &e);
+
+		// all leaf nodes overlapping the element (in cells[firstCell, lastCell)) reside between these two leaf nodes (morton order)
+		int first_overlapping_cell(const GridElement &e, int firstCell, int lastCell);
+		uint32_t last_overlapping_code(const GridElement &e) const;
+
+		// interleave the bits of the grid coordinates
+		static uint32_t morton_code(uint32_t gx, uint32_t gy);
+
+		// generate the AABB boundary box of an element (defined by iStart and iAmount)
+		std::tuple<float, float, float, float> genAABBBox(int iStart, int iAmount);
+
+		// convert the AABB boundary box of an element into grid coordinates. Returns true if the element fits completely into the root node.
+		bool grid_box(const std::tuple<float, float, float, float> &aabb, GridElement &e);
+
+		// amount of points of an element residing inside the root node
+		int count_inside(int iStart, int iAmount, const std::vector<float> *vecX, const std::vector<float> *vecY);
+
+		// the element is stored by Quadtree::insert(): it fits completely into the root node, or some of its points lie inside the root node and its AABB overlaps the interior of the root node
+		bool accepts(int iStart, int iAmount);
+
+		// rebuild the leaf nodes from all elements stored in the tree
+		void rebuild();
+
+		// auxiliary function used by rebuild(). Sorts the elements elements[first, last) (which all fit completely into the node (depth, nx, ny)) into leaf nodes
+		void rebuild_internal(int depth, uint32_t nx, uint32_t ny, std::vector<GridElement> &elements, std::vector<GridElement> &scratch, int first, int last, std::vector<CellEntry> &entries);
+
+		// add an element to the shared space of all leaf nodes in cells[firstCell, lastCell) which overlap the element
+		void insert_shared(const GridElement &e, int firstCell, int lastCell, std::vector<CellEntry> &entries);
+
+		// index of the first leaf node which may overlap the given grid box
+		int first_cell(uint32_t gxmin, uint32_t gymin, int firstCell, int lastCell);
+
+	public:
+		// constructor
+		LinearQuadtree(std::shared_ptr<BoundaryBox> BB_init, std::vector<float>* iVecX, std::vector<float>* iVecY, unsigned int _maxAmtElements = QUADTREE_MAX_ELEMENTS, int _maxDepth = QUADTREE_MAX_DEPTH);
+
+		// insert an element into the tree
+		bool insert(int iStart, int iAmount);
+
+		// replace all elements of the tree by the given elements (iStart, iAmount)
+		bool build(const std::vector< std::pair<int, int> > &elements);
+
+		// remove a single element of the tree
+		bool delete_element(int iStart, int iAmount);
+
+		// relocate a single element. Returns false (and removes the element) if the element (post movement) is not accepted by the root node, or (without changing anything) if (iStartPreMovement, iAmountPreMovement) is no element of the tree.
+		bool relocate_element(int iStartPreMovement, int iAmountPreMovement, const std::vector<float>* relocateNewCoordinatesx, const std::vector<float>* relocateNewCoordinatesy);
+
+		// returns all possible colliding elements corresponding to the leaf nodes which the AABB of this element (iStart, iAmount) overlaps
+		std::set< std::pair<int,int> > fetch_elements(int iStart, int iAmount);
+
+		// count the leaf nodes of the tree
+		int count_nodes();
+
+		// count the elements residing in the leaf nodes of the tree (same as Quadtree::count_elements(), an element whose AABB overlaps the interior of no leaf node resides in none)
+		int count_elements();
+};
+#endif
@@ -1,20 +1,201 @@
 // quadtree class & functions
 #include <math.h>
+#include <cmath>			// std::sqrt
 #include <iostream>
 #include <vector>
 #include <algorithm>	// std::min, std::max
 #include <utility>		// std::unique_ptr
 #include <set>
-
-#include <GL/glut.h>
-#include <GL/gl.h>
+#include <new>			// placement new
+#include <thread>
+#include <atomic>
+#include <mutex>
+#include <condition_variable>
+#include <functional>
 
 #include "quadtree.h"
+#include "quadtree_kernels.h"
+
+
+// constructor (pool)
+QuadtreeNodePool::QuadtreeNodePool(std::size_t _blockSize, std::size_t _blocksPerChunk)
+{
+	blockSize = _blockSize;
+	blocksPerChunk = _blocksPerChunk;
+
+	usedBlocksLastChunk = _blocksPerChunk;	// no chunk available yet
+	freeList = nullptr;
+}
+
+// fetch the memory for a block (reuses released blocks first)
+void *QuadtreeNodePool::allocate_block()
+{
+	std::lock_guard<std::mutex> lock(mutex);
+
+	// recycle a released block
+	if (freeList != nullptr)
+	{
+		void *block = freeList;
+		freeList = *static_cast<void **>(block);
+		return block;
+	}
+
+	// last chunk is exhausted -> allocate a new one
+	if (usedBlocksLastChunk == blocksPerChunk)
+	{
+		chunks.push_back(std::unique_ptr<char[]>(new char[blockSize*blocksPerChunk]));
+		usedBlocksLastChunk = 0;
+	}
+
+	void *block = chunks.back().get() + blockSize*usedBlocksLastChunk;
+	usedBlocksLastChunk++;
+
+	return block;
+}
+
+// return a block to the pool
+void QuadtreeNodePool::release_block(void *block)
+{
+	std::lock_guard<std::mutex> lock(mutex);
+
+	*static_cast<void **>(block) = freeList;
+	freeList = block;
+}
+
+
+// worker threads of fetch_elements_batch(): between the calls the threads wait for the next batch (thread 0 is the calling thread)
+template <typename Scalar>
+struct BasicQuadtree<Scalar>::BatchWorkers
+{
+	std::vector<std::thread> threads;
+
+	std::mutex mutex;
+	std::condition_variable wake;		// a new batch is available or the threads are stopped
+	std::condition_variable finished;	// the last thread of a batch is done
+
+	std::function<void(int)> job;		// job(threadID) of the current batch
+	uint64_t batch = 0;					// number of the current batch
+	int participants = 0;				// the threads 1 ... participants-1 work on the current batch
+	int running = 0;					// threads of the current batch which are not done yet
+	bool stop = false;
+
+	// run job(0) ... job(threadCount-1), job(0) on the calling thread (threads are started if necessary)
+	void run(int threadCount, const std::function<void(int)> &iJob)
+	{
+		std::unique_lock<std::mutex> lock(mutex);
+
+		while ((int)threads.size() < threadCount-1)
+		{
+			threads.emplace_back(&BatchWorkers::work, this, (int)threads.size()+1, batch);
+		}
+
+		job = iJob;
+		participants = threadCount;
+		running = threadCount-1;
+		batch++;
 
+		lock.unlock();
+		wake.notify_all();
+
+		job(0);
+
+		lock.lock();
+		finished.wait(lock, [this]() { return running == 0; });
+
+		job = nullptr;
+	}
+
+	// loop of a worker thread (seenBatch: batch before the thread has been started)
+	void work(int threadID, uint64_t seenBatch)
+	{
+		std::unique_lock<std::mutex> lock(mutex);
+
+		while (true)
+		{
+			wake.wait(lock, [this, seenBatch]() { return stop or (batch != seenBatch); });
+
+			if (stop)
+			{
+				return;
+			}
+
+			seenBatch = batch;
+
+			if (threadID < participants)
+			{
+				lock.unlock();
+				job(threadID);
+				lock.lock();
+
+				if (--running == 0)
+				{
+					finished.notify_one();
+				}
+			}
+		}
+	}
+
+	~BatchWorkers()
+	{
+		{
+			std::lock_guard<std::mutex> lock(mutex);
+			stop = true;
+		}
+
+		wake.notify_all();
+
+		for (auto &thread : threads)
+		{
+			thread.join();
+		}
+	}
+};
 
 // constructor
-Quadtree::Quadtree(std::shared_ptr<BoundaryBox> BB_init, Quadtree *parent, int _nodeDepth, std::vector<float> *iVecX = nullptr, std::vector<float> *iVecY = nullptr)
+template <typename Scalar>
+BasicQuadtree<Scalar>::BasicQuadtree(std::shared_ptr<Box> BB_init, BasicQuadtree *parent, int _nodeDepth, std::vector<Scalar> *iVecX, std::vector<Scalar> *iVecY, unsigned int _maxAmtElements, int _maxDepth) : boundary2(*BB_init)
 {
+#ifdef QUADTREE_FIXED_CONFIG
+	// the configuration fixed at compile time wins
+	if ((parent == nullptr) and ((_maxAmtElements != maxAmtElements) or (_maxDepth != maxDepth)))
+	{
+		std::cout << "Quadtree -> split threshold and maximum depth are fixed at compile time (QUADTREE_MAX_ELEMENTS, QUADTREE_MAX_DEPTH), the arguments are ignored" << std::endl;
+	}
+
+	_maxAmtElements = maxAmtElements;
+	_maxDepth = maxDepth;
+#else
+	if ((_maxAmtElements < 1) or (_maxDepth < 0))
+	{
+		std::cout << "Quadtree -> invalid split threshold or maximum depth" << std::endl;
+		exit(1);
+	}
+#endif
+
+	// integer coordinates: the width of the nodes has to stay exact down to the maximum depth
+	if constexpr (std::is_integral<Scalar>::value)
+	{
+		if ((parent == nullptr) and ((BB_init->dim <= 0) or (_maxDepth > 30) or (BB_init->dim % ((Scalar)1 << _maxDepth) != 0)))
+		{
+			std::cout << "Quadtree -> the width of the root node has to be divisible by 2^maxDepth (integer coordinates)" << std::endl;
+			exit(1);
+		}
+	}
+
+#ifndef QUADTREE_FIXED_CONFIG
+
+	if (parent == nullptr)
+	{
+		maxAmtElements = _maxAmtElements;
+		maxDepth = _maxDepth;
+	}
+	else
+	{
+		maxAmtElements = parent->maxAmtElements;
+		maxDepth = parent->maxDepth;
+	}
+#endif
+
 	// Provide pointer to the std::vector containing all the points.
 	if ((iVecX != nullptr) and (iVecY != nullptr))
 	{
@@ -32,55 +213,125 @@ Quadtree::Quadtree(std::shared_ptr<BoundaryBox> BB_init, Quadtree *parent, int _
 	southWest = nullptr;
 	southEast = nullptr;
 
-	this->boundary2 = std::move(BB_init); 
-
 	if (parent == nullptr)
 	{
 		this->parent = this;
+		nodePool = nullptr;
+		elementIndex = nullptr;
+
+		ownedAABBCache.reset(new AABBCache());
+		aabbCache = ownedAABBCache.get();
+
+		ownedVersions.reset(new Versions());
+		versions = ownedVersions.get();
+
+		ownedMergeSettings.reset(new MergeSettings());
+		mergeSettings = ownedMergeSettings.get();
+		mergeSettings->threshold = maxAmtElements;
+
+		ownedStorageSettings.reset(new StorageSettings());
+		storageSettings = ownedStorageSettings.get();
+
+#ifdef QUADTREE_STATS
+		ownedStatsCounters.reset(new QuadtreeStatsCounters());
+		statsCounters = ownedStatsCounters.get();
+#endif
 	}
 	else
 	{
 		this->parent = parent;
+		nodePool = parent->nodePool;
+		elementIndex = parent->elementIndex;
+		aabbCache = parent->aabbCache;
+		versions = parent->versions;
+		mergeSettings = parent->mergeSettings;
+		storageSettings = parent->storageSettings;
+
+#ifdef QUADTREE_STATS
+		statsCounters = parent->statsCounters;
+#endif
 	}
 
+	mergePending = false;
+
+	this->nodeDepth = _nodeDepth;
+}
+
+// constructor of the children nodes (used by subdivide)
+template <typename Scalar>
+BasicQuadtree<Scalar>::BasicQuadtree(const Box &BB_init, BasicQuadtree *parent, int _nodeDepth) : boundary2(BB_init)
+{
+	ptrToX = parent->ptrToX;
+	ptrToY = parent->ptrToY;
+
+	northWest = nullptr;
+	northEast = nullptr;
+	southWest = nullptr;
+	southEast = nullptr;
+
+	nodePool = parent->nodePool;
+	elementIndex = parent->elementIndex;
+	aabbCache = parent->aabbCache;
+	versions = parent->versions;
+	mergeSettings = parent->mergeSettings;
+	storageSettings = parent->storageSettings;
+	mergePending = false;
+
+#ifdef QUADTREE_STATS
+	statsCounters = parent->statsCounters;
+#endif
+
+#ifndef QUADTREE_FIXED_CONFIG
+	maxAmtElements = parent->maxAmtElements;
+	maxDepth = parent->maxDepth;
+#endif
+
+	this->parent = parent;
 	this->nodeDepth = _nodeDepth;
 }
 
-// clear the tree
-void Quadtree::clear(Quadtree* t)
+// clear the tree (all nodes below the given node *t)
+template <typename Scalar>
+void BasicQuadtree<Scalar>::clear(BasicQuadtree* t)
 {
     if(t != nullptr)
 	{
-		clear(t->northEast);
-		clear(t->northWest);
-		clear(t->southEast);
-		clear(t->southWest);
-
-		delete t;	// calls the destructor
+		t->clearNode();
 	}
 }
 
 // destructor
-Quadtree::~Quadtree()
+template <typename Scalar>
+BasicQuadtree<Scalar>::~BasicQuadtree()
 {
-    delete northWest;
-    delete northEast;
-    delete southWest;
-    delete southEast;
-
-    northWest = nullptr;
-    northEast = nullptr;
-    southWest = nullptr;
-    southEast = nullptr;
+	clearNode();
 }
 
 // delete the children (leaf)nodes (NW, NE, SW, SE) of a specific node.
-void Quadtree::clearNode()
+template <typename Scalar>
+void BasicQuadtree<Scalar>::clearNode()
 {
-    delete northWest;
-    delete northEast;
-    delete southWest;
-    delete southEast;
+	if (northWest != nullptr)
+	{
+		// the four children nodes reside in a single block starting at northWest
+		BasicQuadtree *block = northWest;
+
+		for (int i = 0; i < 4; i++)
+		{
+			block[i].~BasicQuadtree();
+		}
+
+		if (nodePool != nullptr)
+		{
+			nodePool->release_block(block);
+		}
+		else
+		{
+			::operator delete(block);
+		}
+
+		versions->structure.fetch_add(1, std::memory_order_relaxed);
+	}
 
     northWest = nullptr;
     northEast = nullptr;
@@ -88,9 +339,170 @@ void Quadtree::clearNode()
     southEast = nullptr;
 }
 
+// allocate the children nodes from a pool owned by the root node (has to be called on the root node before it is split)
+template <typename Scalar>
+bool BasicQuadtree<Scalar>::enable_node_pool(int blocksPerChunk)
+{
+	if ((this != this->parent) or (northWest != nullptr) or (blocksPerChunk < 1))
+	{
+		return false;
+	}
+
+	ownedNodePool.reset(new QuadtreeNodePool(4*sizeof(BasicQuadtree), blocksPerChunk));
+	nodePool = ownedNodePool.get();
+
+	return true;
+}
+
+
+// create the reverse index (element -> slots in the leaf nodes) of the tree (has to be called on the root node)
+template <typename Scalar>
+bool BasicQuadtree<Scalar>::enable_element_index()
+{
+	if (this != this->parent)
+	{
+		return false;
+	}
+
+	ownedElementIndex.reset(new ElementIndex());
+	elementIndex = ownedElementIndex.get();
+
+	// register the elements which already reside in the tree
+	std::vector<BasicQuadtree *> stack(1, this);
+
+	while (stack.empty() == false)
+	{
+		BasicQuadtree *t = stack.back();
+		stack.pop_back();
+
+		t->elementIndex = elementIndex;
+
+		for (int i = 0; i < (int)t->element_start.size(); i++)
+		{
+			(*elementIndex)[t->element_start[i]].push_back({t, i, false});
+		}
+
+		for (int i = 0; i < (int)t->shared_element_start.size(); i++)
+		{
+			(*elementIndex)[t->shared_element_start[i]].push_back({t, i, true});
+		}
+
+		if (t->northWest != nullptr)
+		{
+			stack.push_back(t->northWest);
+			stack.push_back(t->northEast);
+			stack.push_back(t->southWest);
+			stack.push_back(t->southEast);
+		}
+	}
+
+	return true;
+}
+
+// change the slot of an element in the reverse index (newSlot == -1 -> remove the slot)
+template <typename Scalar>
+void BasicQuadtree<Scalar>::index_replace_slot(int iStart, BasicQuadtree *t, int slot, bool shared, int newSlot)
+{
+	auto it = elementIndex->find(iStart);
+
+	if (it != elementIndex->end())
+	{
+		std::vector<ElementSlot> &slots = it->second;
+
+		for (int i = 0; i < (int)slots.size(); i++)
+		{
+			if ((slots[i].node == t) and (slots[i].slot == slot) and (slots[i].shared == shared))
+			{
+				if (newSlot >= 0)
+				{
+					slots[i].slot = newSlot;
+				}
+				else
+				{
+					slots[i] = slots.back();
+					slots.pop_back();
+
+					if (slots.empty() == true)
+					{
+						elementIndex->erase(it);
+					}
+				}
+
+				return;
+			}
+		}
+	}
+
+	std::cout << "reverse index -> slot of element not found" << std::endl;
+	exit(1);
+}
+
+// add an element to the (shared) space of the node *t
+template <typename Scalar>
+void BasicQuadtree<Scalar>::push_element(BasicQuadtree *t, int iStart, int iAmount, bool shared)
+{
+	std::vector<int> &vecStart  = shared ? t->shared_element_start  : t->element_start;
+	std::vector<int> &vecAmount = shared ? t->shared_element_amount : t->element_amount;
+
+	vecStart.push_back(iStart);
+	vecAmount.push_back(iAmount);
+
+	if (elementIndex != nullptr)
+	{
+		(*elementIndex)[iStart].push_back({t, (int)vecStart.size()-1, shared});
+	}
+}
+
+// remove the element at the given slot from the (shared) space of the node *t. The last element of the vectors is moved into the gap.
+template <typename Scalar>
+void BasicQuadtree<Scalar>::erase_element(BasicQuadtree *t, int slot, bool shared)
+{
+	std::vector<int> &vecStart  = shared ? t->shared_element_start  : t->element_start;
+	std::vector<int> &vecAmount = shared ? t->shared_element_amount : t->element_amount;
+
+	int last = vecStart.size()-1;
+
+	if (elementIndex != nullptr)
+	{
+		index_replace_slot(vecStart[slot], t, slot, shared, -1);
+
+		if (slot != last)
+		{
+			index_replace_slot(vecStart[last], t, last, shared, slot);
+		}
+	}
+
+	vecStart[slot]  = vecStart[last];
+	vecAmount[slot] = vecAmount[last];
+
+	vecStart.pop_back();
+	vecAmount.pop_back();
+}
+
+// remove all slots of the node *t from the reverse index
+template <typename Scalar>
+void BasicQuadtree<Scalar>::unindex_node(BasicQuadtree *t)
+{
+	if (elementIndex == nullptr)
+	{
+		return;
+	}
+
+	for (int i = 0; i < (int)t->element_start.size(); i++)
+	{
+		index_replace_slot(t->element_start[i], t, i, false, -1);
+	}
+
+	for (int i = 0; i < (int)t->shared_element_start.size(); i++)
+	{
+		index_replace_slot(t->shared_element_start[i], t, i, true, -1);
+	}
+}
+
 
 // recursively remove a element from the shared space of all leafnodes containing a given node *t
-void Quadtree::recursive_remove(Quadtree *t, int iStart, int iAmount)
+template <typename Scalar>
+void BasicQuadtree<Scalar>::recursive_remove(BasicQuadtree *t, int iStart, int iAmount)
 {
 	if (t->northWest == nullptr)
 	{
@@ -106,10 +518,12 @@ void Quadtree::recursive_remove(Quadtree *t, int iStart, int iAmount)
 			}
 		}
 
+		QUADTREE_STATS_ADD(removeScans, 1);
+		QUADTREE_STATS_ADD(removeScanLength, std::min(i+1, (int)t->shared_element_start.size()));
+
 		if (found_i == true)
 		{
-			t->shared_element_start.erase(t->shared_element_start.begin()+i);
-			t->shared_element_amount.erase(t->shared_element_amount.begin()+i);
+			erase_element(t, i, true);
 		}
 		else
 		{
@@ -128,10 +542,11 @@ void Quadtree::recursive_remove(Quadtree *t, int iStart, int iAmount)
 
 
 // recursively remove a element from the shared space of all leafnodes containing a given node *t
-void Quadtree::recursive_removeAABB(Quadtree *t, float xmin, float xmax, float ymin, float ymax, int iStart, int iAmount)
+template <typename Scalar>
+void BasicQuadtree<Scalar>::recursive_removeAABB(BasicQuadtree *t, Scalar xmin, Scalar xmax, Scalar ymin, Scalar ymax, int iStart, int iAmount)
 {
-	// collision if:
-	if ((xmax > t->boundary2->cx-t->boundary2->dim) and (xmin < t->boundary2->cx+t->boundary2->dim) and (ymin < t->boundary2->cy+t->boundary2->dim) and (ymax > t->boundary2->cy-t->boundary2->dim))
+	// collision if (exact overlap tests: the polygon of the element has to overlap the node as well):
+	if (element_overlaps_node(t, xmin, xmax, ymin, ymax, iStart, iAmount))
 	{
 		if (t->northWest != nullptr)	// this node has been split yet -> != nullptr
 		{
@@ -155,10 +570,12 @@ void Quadtree::recursive_removeAABB(Quadtree *t, float xmin, float xmax, float y
 				}
 			}
 
+			QUADTREE_STATS_ADD(removeScans, 1);
+			QUADTREE_STATS_ADD(removeScanLength, std::min(i+1, (int)t->shared_element_start.size()));
+
 			if (found_i == true)
 			{
-				t->shared_element_start.erase(t->shared_element_start.begin()+i);
-				t->shared_element_amount.erase(t->shared_element_amount.begin()+i);
+				erase_element(t, i, true);
 			}
 			else
 			{
@@ -175,78 +592,133 @@ void Quadtree::recursive_removeAABB(Quadtree *t, float xmin, float xmax, float y
 
 
 // generate a AABB-boundary box (defined by xmin, xmax, ymin, ymax)
-std::tuple<float, float, float, float> Quadtree::genAABBBox(int iStart, int iAmount)
+template <typename Scalar>
+std::tuple<Scalar, Scalar, Scalar, Scalar> BasicQuadtree<Scalar>::genAABBBox(int iStart, int iAmount) const
 {
-	float xmin = std::numeric_limits<float>::max();
-	float xmax = -std::numeric_limits<float>::max();
-	float ymin = std::numeric_limits<float>::max();
-	float ymax = -std::numeric_limits<float>::max();
-
-	for (int i = iStart; i < (iStart+iAmount); i++)
+	// cached AABB boundary box
+	if ((iStart < (int)aabbCache->amount.size()) and (aabbCache->amount[iStart] == iAmount))
 	{
-		if ((*ptrToX)[i] < xmin)
-			xmin = (*ptrToX)[i];
+		return std::make_tuple(aabbCache->xmin[iStart], aabbCache->xmax[iStart], aabbCache->ymin[iStart], aabbCache->ymax[iStart]);
+	}
 
-		if ((*ptrToX)[i] > xmax)
-			xmax = (*ptrToX)[i];
+	Scalar xmin, xmax, ymin, ymax;
+	points_AABB(ptrToX->data()+iStart, ptrToY->data()+iStart, iAmount, xmin, xmax, ymin, ymax);
 
-		if ((*ptrToY)[i] < ymin)
-			ymin = (*ptrToY)[i];
+	return std::make_tuple(xmin, xmax, ymin, ymax);
+}
 
-		if ((*ptrToY)[i] > ymax)
-			ymax = (*ptrToY)[i];
+// generate the AABB boundary box of an element from its points and store it in the cache
+template <typename Scalar>
+std::tuple<Scalar, Scalar, Scalar, Scalar> BasicQuadtree<Scalar>::refresh_AABB(int iStart, int iAmount)
+{
+	// every point may start an element
+	if (aabbCache->amount.size() < ptrToX->size())
+	{
+		aabbCache->xmin.resize(ptrToX->size());
+		aabbCache->xmax.resize(ptrToX->size());
+		aabbCache->ymin.resize(ptrToX->size());
+		aabbCache->ymax.resize(ptrToX->size());
+		aabbCache->amount.resize(ptrToX->size(), 0);
 	}
 
-    return std::make_tuple(xmin, xmax, ymin, ymax);
+	// invalidate the entry -> generated from the points
+	aabbCache->amount[iStart] = 0;
+
+	auto returnAABB = genAABBBox(iStart, iAmount);
+
+	aabbCache->xmin[iStart] = std::get<0>(returnAABB);
+	aabbCache->xmax[iStart] = std::get<1>(returnAABB);
+	aabbCache->ymin[iStart] = std::get<2>(returnAABB);
+	aabbCache->ymax[iStart] = std::get<3>(returnAABB);
+	aabbCache->amount[iStart] = iAmount;
+
+	return returnAABB;
 }
 
 
-// drawing & colorpicking routine (used by traverse_and_draw). Used by traverse_and_draw()
-void Quadtree::colorPick(float elevate, Quadtree *t, float *depthColor, int depthColorLen)
+// invalidate the cached AABB boundary box of an element
+template <typename Scalar>
+void BasicQuadtree<Scalar>::forget_AABB(int iStart)
 {
-	if(t->boundary2)
+	if (iStart < (int)aabbCache->amount.size())
 	{
-		if (t->nodeDepth*3+2 > depthColorLen)	// default color when the depth exceeds the available colors from the array
-		{
-			glColor4f(0.0f, 0.0f, 0.0f, 1.0f);
-		}
-		else	// pick a color according to the array
-		{
-			glColor4f(depthColor[t->nodeDepth*3], depthColor[t->nodeDepth*3+1], depthColor[t->nodeDepth*3+2], 1.0f);
-		}
+		aabbCache->amount[iStart] = 0;
+	}
+}
+
+
+// fetch the (deepest) node in which the given element resides
+template <typename Scalar>
+BasicQuadtree<Scalar> *BasicQuadtree<Scalar>::fetch_deepest_node(int iStart, int iAmount)
+{
+	auto returnAABB = genAABBBox(iStart, iAmount);
+	Scalar xmin = std::get<0>(returnAABB);
+	Scalar xmax = std::get<1>(returnAABB);
+	Scalar ymin = std::get<2>(returnAABB);
+	Scalar ymax = std::get<3>(returnAABB);
+
+	// every element resides in a single node, which only depends on its AABB boundary box
+	if (single_node_storage())
+	{
+		return fetch_enclosing_node(this, xmin, xmax, ymin, ymax);
+	}
 
-		float centerx = t->boundary2->cx;
-		float centery = t->boundary2->cy;
-		float dim = t->boundary2->dim;
+	auto fits_into = [xmin, xmax, ymin, ymax](const BasicQuadtree *t)
+	{
+		return t->boundary2.contains(xmin, xmax, ymin, ymax);
+	};
 
-		glBegin(GL_LINES);
-			glVertex3f(centerx-dim, centery, elevate);
-			glVertex3f(centerx+dim, centery, elevate);
+	// element resides (partially) outside of the root node -> check the points
+	if (fits_into(this) == false)
+	{
+		BasicQuadtree *node = fetch_deepest_node_internal(this, iStart, iAmount);
 
-			glVertex3f(centerx, centery-dim, elevate);
-			glVertex3f(centerx, centery+dim, elevate);
-		glEnd();
+		// exact overlap tests: the root node also holds the elements whose points all lie outside of it (see insert())
+		if ((node == nullptr) and storageSettings->exactOverlap)
+		{
+			node = this;
+		}
 
+		return node;
 	}
-}
 
+	// descend into the child node which contains the AABB boundary box (i.e., all points) of the element
+	BasicQuadtree *ReturnNode = this;
 
-// fetch the (deepest) node in which the given element resides
-Quadtree *Quadtree::fetch_deepest_node(int iStart, int iAmount)
-{
-	Quadtree *ReturnNode = this;
+	while (ReturnNode->northWest != nullptr)
+	{
+		// integer coordinates: exact quadrant selection
+		if constexpr (std::is_integral<Scalar>::value)
+		{
+			int quadrant = ReturnNode->boundary2.quadrant(xmin, xmax, ymin, ymax);
+
+			if (quadrant < 0)
+				break;
+
+			ReturnNode = &ReturnNode->northWest[quadrant];
+			continue;
+		}
 
-	ReturnNode = fetch_deepest_node_internal(ReturnNode, iStart, iAmount);
+		if (fits_into(ReturnNode->northEast))
+			ReturnNode = ReturnNode->northEast;
+		else if (fits_into(ReturnNode->northWest))
+			ReturnNode = ReturnNode->northWest;
+		else if (fits_into(ReturnNode->southWest))
+			ReturnNode = ReturnNode->southWest;
+		else if (fits_into(ReturnNode->southEast))
+			ReturnNode = ReturnNode->southEast;
+		else
+			break;
+	}
 
 	return ReturnNode;
 }
 
 // auxiliary function used by fetch_deepest_node().
-// Quadtree *Quadtree::fetch_deepest_node_internal(Quadtree *t, int iStart, int iAmount)
-Quadtree *Quadtree::fetch_deepest_node_internal(Quadtree *t, int iStart, int iAmount, const std::vector<float> *vecSearchX, const std::vector<float> *vecSearchY)
+// BasicQuadtree *BasicQuadtree::fetch_deepest_node_internal(BasicQuadtree *t, int iStart, int iAmount)
+template <typename Scalar>
+BasicQuadtree<Scalar> *BasicQuadtree<Scalar>::fetch_deepest_node_internal(BasicQuadtree *t, int iStart, int iAmount, const std::vector<Scalar> *vecSearchX, const std::vector<Scalar> *vecSearchY)
 {
-	int count_inside = iAmount;
-
 	// used in 'relocate_element' -> do not use the 'ptrToX/Y-vectors' here
 	if (vecSearchX == nullptr)
 	{
@@ -258,14 +730,8 @@ Quadtree *Quadtree::fetch_deepest_node_internal(Quadtree *t, int iStart, int iAm
 		vecSearchY = ptrToY;
 	}
 
-		// check if the (end)points of the element reside completely in this node
-		for (int i = iStart; i < (iStart+iAmount); i++)
-		{
-			if ((*vecSearchX)[i] > boundary2->cx+boundary2->dim or (*vecSearchX)[i] <= boundary2->cx-boundary2->dim or (*vecSearchY)[i] > boundary2->cy+boundary2->dim or (*vecSearchY)[i] <= boundary2->cy-boundary2->dim)
-			{
-				count_inside--;
-			}
-		}
+	// check if the (end)points of the element reside completely in this node
+	int count_inside = count_points_inside(vecSearchX->data()+iStart, vecSearchY->data()+iStart, iAmount, boundary2.cx-boundary2.dim, boundary2.cx+boundary2.dim, boundary2.cy-boundary2.dim, boundary2.cy+boundary2.dim);
 
 	// prevent a "Conditional jump or move depends on uninitialised value(s)" detected by valgrind. Last node remaining is the rootnode (t->parent == t) and this node has not been split (t->northEast == nullptr) and the object lies completely outside the rootnode (count_inside == 0) -> return the nullpointer.
 	if ((t->parent == t) && (t->northEast == nullptr) && (count_inside == 0))
@@ -299,27 +765,30 @@ Quadtree *Quadtree::fetch_deepest_node_internal(Quadtree *t, int iStart, int iAm
 
 
 // auxiliary function used by fetch_elements().
-void Quadtree::fetch_elements_internal2(std::set< std::pair<int, int> > &vec, Quadtree *t, float xmin, float xmax, float ymin, float ymax)
+template <typename Scalar>
+void BasicQuadtree<Scalar>::fetch_elements_internal2(std::set< std::pair<int, int> > &vec, BasicQuadtree *t, Scalar xmin, Scalar xmax, Scalar ymin, Scalar ymax, int iStart, int iAmount)
 {
-	// collision if:
-	if ((xmax > t->boundary2->cx-t->boundary2->dim) and (xmin < t->boundary2->cx+t->boundary2->dim) and (ymin < t->boundary2->cy+t->boundary2->dim) and (ymax > t->boundary2->cy-t->boundary2->dim))
+	QUADTREE_STATS_ADD(nodeVisits, 1);
+
+	// collision if (exact overlap tests: the polygon of the element has to overlap the node as well):
+	if (t->boundary2.overlaps_loose(xmin, xmax, ymin, ymax, loose_dim(t)) and ((storageSettings->exactOverlap == false) or polygon_overlaps_node(t, iStart, iAmount)))
 	{
+		// push elements into the vec (inner nodes only hold elements if every element resides in a single node)
+		for (int i = 0; i < (int)t->element_start.size(); i++)
+		{
+			vec.insert(std::make_pair(t->element_start[i], t->element_amount[i]));
+		}
+
 		if (t->northWest != nullptr)	// this node has been split yet -> != nullptr
 		{
-			fetch_elements_internal2(vec, t->northEast, xmin, xmax, ymin, ymax);
-			fetch_elements_internal2(vec, t->northWest, xmin, xmax, ymin, ymax);
-			fetch_elements_internal2(vec, t->southEast, xmin, xmax, ymin, ymax);
-			fetch_elements_internal2(vec, t->southWest, xmin, xmax, ymin, ymax);
+			fetch_elements_internal2(vec, t->northEast, xmin, xmax, ymin, ymax, iStart, iAmount);
+			fetch_elements_internal2(vec, t->northWest, xmin, xmax, ymin, ymax, iStart, iAmount);
+			fetch_elements_internal2(vec, t->southEast, xmin, xmax, ymin, ymax, iStart, iAmount);
+			fetch_elements_internal2(vec, t->southWest, xmin, xmax, ymin, ymax, iStart, iAmount);
 		}
 		else	// deepest node possible
 		{
-			// push elements into the vec
-			for (int i = 0; i < (int)t->element_start.size(); i++)
-			{
-				vec.insert(std::make_pair(t->element_start[i], t->element_amount[i]));
-			}
-
-			for (int i = 0; i < (int)t->shared_element_start.size(); i++)
+			for (int i = 0; i < (int)t->shared_element_start.size(); i++)
 			{
 				vec.insert(std::make_pair(t->shared_element_start[i], t->shared_element_amount[i]));
 			}
@@ -333,10 +802,108 @@ void Quadtree::fetch_elements_internal2(std::set< std::pair<int, int> > &vec, Qu
 
 
 // returns all possible colliding elements corresponding to the node in which this element (iStart, iAmount) resides
-std::set< std::pair<int,int> > Quadtree::fetch_elements(int iStart, int iAmount)
+template <typename Scalar>
+void BasicQuadtree<Scalar>::fetch_elements(int iStart, int iAmount, std::vector< std::pair<int, int> > &vec)
+{
+	visit_elements(iStart, iAmount, [&vec](int elementStart, int elementAmount) { vec.push_back(std::make_pair(elementStart, elementAmount)); });
+}
+
+// start a new query (stamps of the previous queries become invalid)
+template <typename Scalar>
+void BasicQuadtree<Scalar>::next_query_epoch(QueryScratch &scratch) const
+{
+	// every point may start an element
+	if (scratch.stamp.size() < ptrToX->size())
+	{
+		scratch.stamp.resize(ptrToX->size(), scratch.epoch);
+	}
+
+	scratch.epoch++;
+
+	// overflow of the epoch -> reset all stamps
+	if (scratch.epoch == 0)
+	{
+		std::fill(scratch.stamp.begin(), scratch.stamp.end(), 0);
+		scratch.epoch = 1;
+	}
+}
+
+template <typename Scalar>
+void BasicQuadtree<Scalar>::fetch_elements_batch(const std::vector< std::pair<int, int> > &queries, std::vector< std::vector< std::pair<int, int> > > &results, int threadCount)
+{
+	QUADTREE_STATS_TIMER(QUADTREE_OP_FETCH_BATCH);
+
+	if (threadCount <= 0)
+	{
+		threadCount = std::max(1, (int)std::thread::hardware_concurrency());
+	}
+
+	// queries are handed out in chunks to the threads (dynamic load balancing)
+	const int chunkSize = 64;
+	const int amtQueries = queries.size();
+	threadCount = std::max(1, std::min(threadCount, (amtQueries+chunkSize-1)/chunkSize));
+
+	results.resize(amtQueries);
+
+	// one scratch per thread (kept for the next call)
+	if ((int)batchScratch.size() < threadCount)
+	{
+		batchScratch.resize(threadCount);
+	}
+
+	std::atomic<int> nextQuery(0);
+
+	auto worker = [&](int threadID)
+	{
+		QueryScratch &scratch = batchScratch[threadID];
+
+		for (int first = nextQuery.fetch_add(chunkSize); first < amtQueries; first = nextQuery.fetch_add(chunkSize))
+		{
+			int last = std::min(first+chunkSize, amtQueries);
+
+			for (int i = first; i < last; i++)
+			{
+				std::vector< std::pair<int, int> > &vec = results[i];
+				vec.clear();
+
+				next_query_epoch(scratch);
+
+				auto returnAABB = genAABBBox(queries[i].first, queries[i].second);
+				auto visitor = [&vec](int elementStart, int elementAmount) { vec.push_back(std::make_pair(elementStart, elementAmount)); };
+
+				visit_elements_internal(this, std::get<0>(returnAABB), std::get<1>(returnAABB), std::get<2>(returnAABB), std::get<3>(returnAABB), queries[i].first, queries[i].second, scratch, visitor);
+			}
+
+			QUADTREE_STATS_ADD(queries, last-first);
+		}
+
+		QUADTREE_STATS_ADD(nodeVisits, scratch.nodeVisits);
+		QUADTREE_STATS_ONLY(scratch.nodeVisits = 0);
+	};
+
+	if (threadCount == 1)
+	{
+		worker(0);
+		return;
+	}
+
+	// the calling thread works as well, the worker threads are kept for the next call
+	if (batchWorkers == nullptr)
+	{
+		batchWorkers.reset(new BatchWorkers());
+	}
+
+	batchWorkers->run(threadCount, worker);
+}
+
+template <typename Scalar>
+std::set< std::pair<int,int> > BasicQuadtree<Scalar>::fetch_elements(int iStart, int iAmount)
 {
+	QUADTREE_STATS_TIMER(QUADTREE_OP_FETCH);
+	QUADTREE_STATS_ADD(queries, 1);
+
 	// find the deepest node possible in which this shape fits completely
-// 	Quadtree *fetch_node = fetch_deepest_node(iStart, iAmount);
+// 	BasicQuadtree *fetch_node = fetch_deepest_node(iStart, iAmount);
 
 	// create the vec for returning the elements
 	std::set< std::pair<int, int> > vec;
@@ -344,237 +911,1688 @@ std::set< std::pair<int,int> > Quadtree::fetch_elements(int iStart, int iAmount)
 	// TODO: FASTER THAN WITH FETCH_NODE?
 	// generate the AABB boundary box
 	auto returnAABB = genAABBBox(iStart, iAmount);
-	float xmin = std::get<0>(returnAABB);
-	float xmax = std::get<1>(returnAABB);
-	float ymin = std::get<2>(returnAABB);
-	float ymax = std::get<3>(returnAABB);
+	Scalar xmin = std::get<0>(returnAABB);
+	Scalar xmax = std::get<1>(returnAABB);
+	Scalar ymin = std::get<2>(returnAABB);
+	Scalar ymax = std::get<3>(returnAABB);
 
-	fetch_elements_internal2(vec, this, xmin, xmax, ymin, ymax);
+	fetch_elements_internal2(vec, this, xmin, xmax, ymin, ymax, iStart, iAmount);
 	// FASTER THAN WITH FETCH_NODE?
 
 	return vec;
 }
 
 
-// recursively insert a element into all leaf nodes (deepest nodes possible) of a given node (*t)
-void Quadtree::test2(Quadtree* t, float xmin, float xmax, float ymin, float ymax, int iStart, int iAmount)
-{
-	// collision if:
-	if ((xmax > t->boundary2->cx-t->boundary2->dim) and (xmin < t->boundary2->cx+t->boundary2->dim) and (ymin < t->boundary2->cy+t->boundary2->dim) and (ymax > t->boundary2->cy-t->boundary2->dim))
+namespace
+{
+	// The helpers of the queries compute in Real (the type of the geometric computations, see BasicQuadtree::Real), the points of the elements are of the coordinate type Scalar.
+
+	// point inside the polygon (x[i], y[i]), i = 0 ... amount-1 (even-odd rule)
+	template <typename Scalar, typename Real>
+	bool point_in_polygon(const Scalar *x, const Scalar *y, int amount, Real px, Real py)
+	{
+		bool in = false;
+
+		for (int i = 0, j = amount-1; i < amount; j = i++)
+		{
+			Real xi = x[i], yi = y[i];
+			Real xj = x[j], yj = y[j];
+
+			if (((yi > py) != (yj > py)) and (px < (xj-xi)*(py-yi)/(yj-yi) + xi))
+			{
+				in = !in;
+			}
+		}
+
+		return in;
+	}
+
+	// regions of the region queries. overlaps(): the region touches the box of a node, contains(): the box lies completely inside the region.
+	template <typename Real>
+	struct RegionAABB
+	{
+		Real xmin, xmax, ymin, ymax;
+
+		bool overlaps(Real bxmin, Real bxmax, Real bymin, Real bymax) const
+		{
+			return (xmax >= bxmin) and (xmin <= bxmax) and (ymax >= bymin) and (ymin <= bymax);
+		}
+
+		bool contains(Real bxmin, Real bxmax, Real bymin, Real bymax) const
+		{
+			return (xmin <= bxmin) and (xmax >= bxmax) and (ymin <= bymin) and (ymax >= bymax);
+		}
+	};
+
+	template <typename Real>
+	struct RegionCircle
+	{
+		Real cx, cy, r;
+
+		bool overlaps(Real bxmin, Real bxmax, Real bymin, Real bymax) const
+		{
+			// closest point of the box
+			Real dx = std::max(Real(0), std::max(bxmin-cx, cx-bxmax));
+			Real dy = std::max(Real(0), std::max(bymin-cy, cy-bymax));
+
+			return dx*dx + dy*dy <= r*r;
+		}
+
+		bool contains(Real bxmin, Real bxmax, Real bymin, Real bymax) const
+		{
+			// farthest corner of the box
+			Real dx = std::max(cx-bxmin, bxmax-cx);
+			Real dy = std::max(cy-bymin, bymax-cy);
+
+			return dx*dx + dy*dy <= r*r;
+		}
+	};
+
+	template <typename Scalar, typename Real>
+	struct RegionPolygon
+	{
+		const Scalar *x;
+		const Scalar *y;
+		int amount;
+
+		// AABB boundary box of the polygon
+		Scalar xmin, xmax, ymin, ymax;
+
+		// point inside the polygon (even-odd rule)
+		bool inside(Real px, Real py) const
+		{
+			return point_in_polygon(x, y, amount, px, py);
+		}
+
+		// an edge of the polygon touches the box (clipping of the edges against the box)
+		bool edge_touches(Real bxmin, Real bxmax, Real bymin, Real bymax) const
+		{
+			for (int i = 0, j = amount-1; i < amount; j = i++)
+			{
+				Real t0 = 0;
+				Real t1 = 1;
+				Real xj = x[j];
+				Real yj = y[j];
+				Real dx = x[i]-xj;
+				Real dy = y[i]-yj;
+
+				// clip against the four sides of the box (p*t <= q)
+				Real p[4] = {-dx, dx, -dy, dy};
+				Real q[4] = {xj-bxmin, bxmax-xj, yj-bymin, bymax-yj};
+
+				bool touches = true;
+
+				for (int k = 0; (k < 4) and touches; k++)
+				{
+					if (p[k] == 0)
+					{
+						touches = (q[k] >= 0);
+					}
+					else if (p[k] < 0)
+					{
+						t0 = std::max(t0, q[k]/p[k]);
+					}
+					else
+					{
+						t1 = std::min(t1, q[k]/p[k]);
+					}
+
+					touches = touches and (t0 <= t1);
+				}
+
+				if (touches)
+				{
+					return true;
+				}
+			}
+
+			return false;
+		}
+
+		bool overlaps(Real bxmin, Real bxmax, Real bymin, Real bymax) const
+		{
+			if ((amount == 0) or (xmax < bxmin) or (xmin > bxmax) or (ymax < bymin) or (ymin > bymax))
+			{
+				return false;
+			}
+
+			// the box lies inside the polygon or the boundary of the polygon passes through the box
+			return inside(bxmin, bymin) or edge_touches(bxmin, bxmax, bymin, bymax);
+		}
+
+		bool contains(Real bxmin, Real bxmax, Real bymin, Real bymax) const
+		{
+			// all corners inside and no edge passing through the box (conservative if an edge only touches the box)
+			return (amount >= 3) and inside(bxmin, bymin) and inside(bxmax, bymin) and inside(bxmin, bymax) and inside(bxmax, bymax) and (edge_touches(bxmin, bxmax, bymin, bymax) == false);
+		}
+	};
+
+	// Slab test: the ray (ox, oy) + t*(dx, dy) passes the box [xmin, xmax] x [ymin, ymax]. On input [t0, t1] is the range of t to be searched, on output the range of t inside the box.
+	template <typename Real>
+	bool ray_box(Real ox, Real oy, Real dx, Real dy, Real invdx, Real invdy, Real xmin, Real xmax, Real ymin, Real ymax, Real &t0, Real &t1)
+	{
+		if (dx == 0)
+		{
+			if ((ox < xmin) or (ox > xmax))
+			{
+				return false;
+			}
+		}
+		else
+		{
+			Real tx0 = (xmin-ox)*invdx;
+			Real tx1 = (xmax-ox)*invdx;
+
+			t0 = std::max(t0, std::min(tx0, tx1));
+			t1 = std::min(t1, std::max(tx0, tx1));
+		}
+
+		if (dy == 0)
+		{
+			if ((oy < ymin) or (oy > ymax))
+			{
+				return false;
+			}
+		}
+		else
+		{
+			Real ty0 = (ymin-oy)*invdy;
+			Real ty1 = (ymax-oy)*invdy;
+
+			t0 = std::max(t0, std::min(ty0, ty1));
+			t1 = std::min(t1, std::max(ty0, ty1));
+		}
+
+		return t0 <= t1;
+	}
+
+	// Distance along the ray (normalized direction) to the first intersection with the element (x[i], y[i]), i = 0 ... amount-1 (closed polygon, 2 points: segment, 1 point: point). Returns -1 if the element is not hit within [0, maxDist].
+	template <typename Scalar, typename Real>
+	Real ray_element_distance(const Scalar *x, const Scalar *y, int amount, Real ox, Real oy, Real dx, Real dy, Real maxDist)
+	{
+		Real best = -1;
+
+		auto consider = [&best, maxDist](Real t)
+		{
+			if ((t >= 0) and (t <= maxDist) and ((best < 0) or (t < best)))
+			{
+				best = t;
+			}
+		};
+
+		// point on the ray
+		if (amount == 1)
+		{
+			Real wx = x[0]-ox;
+			Real wy = y[0]-oy;
+
+			if (wx*dy - wy*dx == 0)
+			{
+				consider(wx*dx + wy*dy);
+			}
+
+			return best;
+		}
+
+		// the origin lies inside the polygon
+		if ((amount >= 3) and point_in_polygon(x, y, amount, ox, oy))
+		{
+			return 0;
+		}
+
+		int amtEdges = (amount == 2) ? 1 : amount;
+
+		for (int i = 0; i < amtEdges; i++)
+		{
+			int j = (i+1 == amount) ? 0 : i+1;
+
+			// edge (x[i], y[i]) + u*(ex, ey), u = 0 ... 1
+			Real ex = (Real)x[j]-(Real)x[i];
+			Real ey = (Real)y[j]-(Real)y[i];
+			Real wx = x[i]-ox;
+			Real wy = y[i]-oy;
+
+			Real denom = dx*ey - dy*ex;
+
+			// parallel edge -> hit only if it lies on the ray
+			if (denom == 0)
+			{
+				if (wx*dy - wy*dx == 0)
+				{
+					Real ta = wx*dx + wy*dy;
+					Real tb = (x[j]-ox)*dx + (y[j]-oy)*dy;
+
+					if (std::max(ta, tb) >= 0)
+					{
+						consider(std::max(Real(0), std::min(ta, tb)));
+					}
+				}
+
+				continue;
+			}
+
+			Real u = (wx*dy - wy*dx)/denom;
+
+			if ((u >= 0) and (u <= 1))
+			{
+				consider((wx*ey - wy*ex)/denom);
+			}
+		}
+
+		return best;
+	}
+}
+
+// elements of all leaf nodes touching the region (a subtree whose node lies completely inside the region is reported without testing its nodes)
+template <typename Scalar>
+template <typename Region>
+void BasicQuadtree<Scalar>::query_region(const Region &region, std::vector< std::pair<int, int> > &vec)
+{
+	QUADTREE_STATS_TIMER(QUADTREE_OP_REGION);
+
+	next_query_epoch(queryScratch);
+
+	auto visitor = [&vec](int elementStart, int elementAmount) { vec.push_back(std::make_pair(elementStart, elementAmount)); };
+
+	visit_region_internal(this, region, queryScratch, visitor);
+
+	QUADTREE_STATS_ADD(queries, 1);
+	QUADTREE_STATS_ADD(nodeVisits, queryScratch.nodeVisits);
+	QUADTREE_STATS_ONLY(queryScratch.nodeVisits = 0);
+}
+
+template <typename Scalar>
+template <typename Region, typename Visitor>
+void BasicQuadtree<Scalar>::visit_region_internal(const BasicQuadtree *t, const Region &region, QueryScratch &scratch, Visitor &visitor) const
+{
+	QUADTREE_STATS_ONLY(scratch.nodeVisits++);
+
+	// bounds of the node (enlarged for loose bounds, see set_storage())
+	Real looseDim = loose_dim(t);
+	Real bxmin = t->boundary2.cx-looseDim;
+	Real bxmax = t->boundary2.cx+looseDim;
+	Real bymin = t->boundary2.cy-looseDim;
+	Real bymax = t->boundary2.cy+looseDim;
+
+	// no collision
+	if (region.overlaps(bxmin, bxmax, bymin, bymax) == false)
+	{
+		return;
+	}
+
+	// the whole subtree lies inside the region
+	if ((t->northWest != nullptr) and region.contains(bxmin, bxmax, bymin, bymax))
+	{
+		visit_subtree_internal(t, scratch, visitor);
+		return;
+	}
+
+	if (t->northWest != nullptr)	// this node has been split yet -> != nullptr
+	{
+		// elements of the inner node (every element resides in a single node)
+		for (int i = 0; i < (int)t->element_start.size(); i++)
+		{
+			visitor(t->element_start[i], t->element_amount[i]);
+		}
+
+		visit_region_internal(t->northEast, region, scratch, visitor);
+		visit_region_internal(t->northWest, region, scratch, visitor);
+		visit_region_internal(t->southEast, region, scratch, visitor);
+		visit_region_internal(t->southWest, region, scratch, visitor);
+		return;
+	}
+
+	visit_subtree_internal(t, scratch, visitor);
+}
+
+// report all elements of the subtree of *t (every shared element only once per query)
+template <typename Scalar>
+template <typename Visitor>
+void BasicQuadtree<Scalar>::visit_subtree_internal(const BasicQuadtree *t, QueryScratch &scratch, Visitor &visitor) const
+{
+	// inner nodes only hold elements if every element resides in a single node
+	for (int i = 0; i < (int)t->element_start.size(); i++)
+	{
+		visitor(t->element_start[i], t->element_amount[i]);
+	}
+
+	if (t->northWest != nullptr)	// this node has been split yet -> != nullptr
+	{
+		QUADTREE_STATS_ONLY(scratch.nodeVisits++);
+
+		visit_subtree_internal(t->northEast, scratch, visitor);
+		visit_subtree_internal(t->northWest, scratch, visitor);
+		visit_subtree_internal(t->southEast, scratch, visitor);
+		visit_subtree_internal(t->southWest, scratch, visitor);
+		return;
+	}
+
+	for (int i = 0; i < (int)t->shared_element_start.size(); i++)
+	{
+		int sharedStart = t->shared_element_start[i];
+
+		if (scratch.stamp[sharedStart] != scratch.epoch)
+		{
+			scratch.stamp[sharedStart] = scratch.epoch;
+			visitor(sharedStart, t->shared_element_amount[i]);
+		}
+	}
+}
+
+// elements of all leaf nodes touching the rectangle [xmin, xmax] x [ymin, ymax]
+template <typename Scalar>
+void BasicQuadtree<Scalar>::query_aabb(Scalar xmin, Scalar xmax, Scalar ymin, Scalar ymax, std::vector< std::pair<int, int> > &vec)
+{
+	RegionAABB<Real> region = {(Real)xmin, (Real)xmax, (Real)ymin, (Real)ymax};
+
+	query_region(region, vec);
+}
+
+// elements of all leaf nodes touching the circle of radius r around (cx, cy)
+template <typename Scalar>
+void BasicQuadtree<Scalar>::query_circle(Scalar cx, Scalar cy, Real r, std::vector< std::pair<int, int> > &vec)
+{
+	RegionCircle<Real> region = {(Real)cx, (Real)cy, r};
+
+	query_region(region, vec);
+}
+
+// elements of all leaf nodes touching the polygon
+template <typename Scalar>
+void BasicQuadtree<Scalar>::query_polygon(const std::vector<Scalar> &polygonX, const std::vector<Scalar> &polygonY, std::vector< std::pair<int, int> > &vec)
+{
+	if (polygonX.size() != polygonY.size())
+	{
+		std::cout << "query_polygon -> amount of x- and y-coordinates of the polygon differ" << std::endl;
+		exit(1);
+	}
+
+	RegionPolygon<Scalar, Real> region;
+	region.x = polygonX.data();
+	region.y = polygonY.data();
+	region.amount = polygonX.size();
+
+	points_AABB(region.x, region.y, region.amount, region.xmin, region.xmax, region.ymin, region.ymax);
+
+	query_region(region, vec);
+}
+
+
+// cast a ray through the tree (front to back)
+template <typename Scalar>
+void BasicQuadtree<Scalar>::raycast(Scalar ox, Scalar oy, Real dx, Real dy, Real maxDist, std::vector<Hit> &hits, bool firstHitOnly)
+{
+	QUADTREE_STATS_TIMER(QUADTREE_OP_RAYCAST);
+
+	hits.clear();
+
+	Real length = std::sqrt(dx*dx + dy*dy);
+
+	if ((length == 0) or (maxDist < 0))
+	{
+		return;
+	}
+
+	Ray ray;
+	ray.ox = ox;
+	ray.oy = oy;
+	ray.dx = dx/length;
+	ray.dy = dy/length;
+	ray.invdx = 1/ray.dx;
+	ray.invdy = 1/ray.dy;
+	ray.maxDist = maxDist;
+	ray.firstHitOnly = firstHitOnly;
+
+	// shared elements reside in several leaf nodes -> test them only once
+	next_query_epoch(queryScratch);
+
+	Real t0 = 0;
+	Real t1 = maxDist;
+
+	if (ray_box<Real>(ray.ox, ray.oy, ray.dx, ray.dy, ray.invdx, ray.invdy, boundary2.cx-boundary2.dim, boundary2.cx+boundary2.dim, boundary2.cy-boundary2.dim, boundary2.cy+boundary2.dim, t0, t1))
+	{
+		raycast_internal(this, ray, t0, hits);
+	}
+
+	// closest hit first
+	std::sort(hits.begin(), hits.end(), [](const Hit &a, const Hit &b) { return (a.distance < b.distance) or ((a.distance == b.distance) and (a.iStart < b.iStart)); });
+
+	QUADTREE_STATS_ADD(queries, 1);
+	QUADTREE_STATS_ADD(nodeVisits, queryScratch.nodeVisits);
+	QUADTREE_STATS_ONLY(queryScratch.nodeVisits = 0);
+}
+
+// cast the segment from (ax, ay) to (bx, by)
+template <typename Scalar>
+void BasicQuadtree<Scalar>::segment_query(Scalar ax, Scalar ay, Scalar bx, Scalar by, std::vector<Hit> &hits, bool firstHitOnly)
+{
+	Real dx = (Real)bx-(Real)ax;
+	Real dy = (Real)by-(Real)ay;
+	Real length = std::sqrt(dx*dx + dy*dy);
+
+	// degenerate segment -> only the elements containing the point (any direction)
+	if (length == 0)
+	{
+		raycast(ax, ay, 1, 0, 0, hits, firstHitOnly);
+		return;
+	}
+
+	raycast(ax, ay, dx, dy, length, hits, firstHitOnly);
+}
+
+template <typename Scalar>
+bool BasicQuadtree<Scalar>::raycast_internal(const BasicQuadtree *t, const Ray &ray, Real tEnter, std::vector<Hit> &hits)
+{
+	QUADTREE_STATS_ONLY(queryScratch.nodeVisits++);
+
+	// the closest hit found so far lies in front of this node (and all nodes visited after it)
+	if (ray.firstHitOnly and (hits.empty() == false) and (hits[0].distance < tEnter))
+	{
+		return true;
+	}
+
+	auto test_element = [&](int iStart, int iAmount)
+	{
+		// the AABB boundary box has to be passed first
+		auto returnAABB = genAABBBox(iStart, iAmount);
+		Real t0 = 0;
+		Real t1 = ray.maxDist;
+
+		if (ray_box<Real>(ray.ox, ray.oy, ray.dx, ray.dy, ray.invdx, ray.invdy, std::get<0>(returnAABB), std::get<1>(returnAABB), std::get<2>(returnAABB), std::get<3>(returnAABB), t0, t1) == false)
+		{
+			return;
+		}
+
+		if (ray.firstHitOnly and (hits.empty() == false) and (t0 > hits[0].distance))
+		{
+			return;
+		}
+
+		Real distance = ray_element_distance(ptrToX->data()+iStart, ptrToY->data()+iStart, iAmount, ray.ox, ray.oy, ray.dx, ray.dy, ray.maxDist);
+
+		if (distance < 0)
+		{
+			return;
+		}
+
+		Hit hit = {iStart, iAmount, distance};
+
+		if (ray.firstHitOnly == false)
+		{
+			hits.push_back(hit);
+		}
+		else if (hits.empty())
+		{
+			hits.push_back(hit);
+		}
+		else if ((distance < hits[0].distance) or ((distance == hits[0].distance) and (iStart < hits[0].iStart)))
+		{
+			hits[0] = hit;
+		}
+	};
+
+	// the elements of a node are tested before its children nodes (the elements of an inner node may be hit in front of its children)
+	for (int i = 0; i < (int)t->element_start.size(); i++)
+	{
+		test_element(t->element_start[i], t->element_amount[i]);
+	}
+
+	for (int i = 0; i < (int)t->shared_element_start.size(); i++)
+	{
+		int sharedStart = t->shared_element_start[i];
+
+		if (queryScratch.stamp[sharedStart] != queryScratch.epoch)
+		{
+			queryScratch.stamp[sharedStart] = queryScratch.epoch;
+			test_element(sharedStart, t->shared_element_amount[i]);
+		}
+	}
+
+	if (t->northWest != nullptr)	// this node has been split yet -> != nullptr
+	{
+		// children nodes passed by the ray, ordered by the distance the ray enters them
+		const BasicQuadtree *children[4] = {t->northEast, t->northWest, t->southWest, t->southEast};
+		std::pair<Real, const BasicQuadtree *> order[4];
+		int amtOrder = 0;
+
+		for (const BasicQuadtree *child : children)
+		{
+			Real t0 = 0;
+			Real t1 = ray.maxDist;
+
+			Real childDim = loose_dim(child);
+
+			if (ray_box<Real>(ray.ox, ray.oy, ray.dx, ray.dy, ray.invdx, ray.invdy, child->boundary2.cx-childDim, child->boundary2.cx+childDim, child->boundary2.cy-childDim, child->boundary2.cy+childDim, t0, t1))
+			{
+				int k = amtOrder++;
+
+				for (; (k > 0) and (order[k-1].first > t0); k--)
+				{
+					order[k] = order[k-1];
+				}
+
+				order[k] = std::make_pair(t0, child);
+			}
+		}
+
+		for (int i = 0; i < amtOrder; i++)
+		{
+			if (raycast_internal(order[i].second, ray, order[i].first, hits))
+			{
+				// The remaining children nodes are entered even later. Exact bounds: the ray passes the disjoint nodes one after another, i.e., this holds for all remaining nodes. Loose bounds: the enlarged nodes overlap -> only the children of this node are skipped.
+				if (storageSettings->looseness > 1)
+				{
+					break;
+				}
+
+				return true;
+			}
+		}
+	}
+
+	return false;
+}
+
+
+// fetch the k elements closest to the point (px, py)
+template <typename Scalar>
+void BasicQuadtree<Scalar>::fetch_nearest_elements(Scalar px, Scalar py, int k, std::vector<Nearest> &result)
+{
+	QUADTREE_STATS_TIMER(QUADTREE_OP_NEAREST);
+	QUADTREE_STATS_ADD(queries, 1);
+
+	result.clear();
+
+	if (k <= 0)
+	{
+		return;
+	}
+
+	// shared elements reside in several leaf nodes -> consider them only once
+	next_query_epoch(queryScratch);
+
+	// Lower bound of the distance of the elements of a node: distance from the query point (clamped to the root node) to the node. Elements may stick out of their leaf nodes (shared space) or out of the root node, but the point of an element closest to the query point, clamped to the root node, lies inside a leaf node holding this element. Elements residing in a single node lie inside the (enlarged) bounds of their node, which lie inside the (enlarged) root node, except for the elements of the root node, which are considered first.
+	Real rootDim = loose_dim(this);
+	Real qx = std::min(std::max((Real)px, boundary2.cx-rootDim), boundary2.cx+rootDim);
+	Real qy = std::min(std::max((Real)py, boundary2.cy-rootDim), boundary2.cy+rootDim);
+
+	auto squared_distance_to_box = [](Real x, Real y, Real xmin, Real xmax, Real ymin, Real ymax)
+	{
+		Real dx = std::max(Real(0), std::max(xmin-x, x-xmax));
+		Real dy = std::max(Real(0), std::max(ymin-y, y-ymax));
+
+		return dx*dx + dy*dy;
+	};
+
+	auto node_distance = [&](const BasicQuadtree *t)
+	{
+		Real looseDim = loose_dim(t);
+
+		return squared_distance_to_box(qx, qy, t->boundary2.cx-looseDim, t->boundary2.cx+looseDim, t->boundary2.cy-looseDim, t->boundary2.cy+looseDim);
+	};
+
+	// result: bounded max-heap of the k closest elements found so far (distance squared until the end of the query, ties: larger iStart first)
+	auto farther = [](const Nearest &a, const Nearest &b)
+	{
+		return (a.distance < b.distance) or ((a.distance == b.distance) and (a.iStart < b.iStart));
+	};
+
+	auto consider_element = [&](int iStart, int iAmount)
+	{
+		bool full = ((int)result.size() == k);
+
+		// the AABB boundary box is a lower bound of the distance to the points of the element
+		auto returnAABB = genAABBBox(iStart, iAmount);
+
+		if (full and (squared_distance_to_box(px, py, std::get<0>(returnAABB), std::get<1>(returnAABB), std::get<2>(returnAABB), std::get<3>(returnAABB)) > result.front().distance))
+		{
+			return;
+		}
+
+		Nearest candidate = {iStart, iAmount, min_squared_distance(ptrToX->data()+iStart, ptrToY->data()+iStart, iAmount, px, py)};
+
+		if (full)
+		{
+			if (farther(candidate, result.front()) == false)
+			{
+				return;
+			}
+
+			std::pop_heap(result.begin(), result.end(), farther);
+			result.pop_back();
+		}
+
+		result.push_back(candidate);
+		std::push_heap(result.begin(), result.end(), farther);
+	};
+
+	// nodes to be searched (min-heap of the distances)
+	std::vector< std::pair<Real, const BasicQuadtree *> > &nodeQueue = queryScratch.nodeQueue;
+	auto closer = [](const std::pair<Real, const BasicQuadtree *> &a, const std::pair<Real, const BasicQuadtree *> &b) { return a.first > b.first; };
+
+	nodeQueue.clear();
+	nodeQueue.push_back(std::make_pair(node_distance(this), this));
+
+	while (nodeQueue.empty() == false)
+	{
+		std::pop_heap(nodeQueue.begin(), nodeQueue.end(), closer);
+		Real distance = nodeQueue.back().first;
+		const BasicQuadtree *t = nodeQueue.back().second;
+		nodeQueue.pop_back();
+
+		// all remaining nodes are farther away than the k-th element found so far
+		if (((int)result.size() == k) and (distance > result.front().distance))
+		{
+			break;
+		}
+
+		QUADTREE_STATS_ADD(nodeVisits, 1);
+
+		// inner nodes only hold elements if every element resides in a single node
+		for (int i = 0; i < (int)t->element_start.size(); i++)
+		{
+			consider_element(t->element_start[i], t->element_amount[i]);
+		}
+
+		if (t->northWest != nullptr)	// this node has been split yet -> != nullptr
+		{
+			const BasicQuadtree *children[4] = {t->northEast, t->northWest, t->southWest, t->southEast};
+
+			for (const BasicQuadtree *child : children)
+			{
+				nodeQueue.push_back(std::make_pair(node_distance(child), child));
+				std::push_heap(nodeQueue.begin(), nodeQueue.end(), closer);
+			}
+
+			continue;
+		}
+
+		for (int i = 0; i < (int)t->shared_element_start.size(); i++)
+		{
+			int sharedStart = t->shared_element_start[i];
+
+			if (queryScratch.stamp[sharedStart] != queryScratch.epoch)
+			{
+				queryScratch.stamp[sharedStart] = queryScratch.epoch;
+				consider_element(sharedStart, t->shared_element_amount[i]);
+			}
+		}
+	}
+
+	// closest element first
+	std::sort_heap(result.begin(), result.end(), farther);
+
+	for (Nearest &element : result)
+	{
+		element.distance = std::sqrt(element.distance);
+	}
+}
+
+
+// used by collect_candidate_pairs()
+template <typename Scalar>
+void BasicQuadtree<Scalar>::collect_candidate_pairs_internal(BasicQuadtree *t, std::vector<ElementPair> &pairs, std::vector< std::tuple<Scalar, Scalar, Scalar, Scalar> > &leafAABB, std::vector<ElementSlot> *sharedSlots)
+{
+	if (t->northWest != nullptr)	// this node has been split yet -> != nullptr
+	{
+		collect_candidate_pairs_internal(t->northEast, pairs, leafAABB, sharedSlots);
+		collect_candidate_pairs_internal(t->northWest, pairs, leafAABB, sharedSlots);
+		collect_candidate_pairs_internal(t->southEast, pairs, leafAABB, sharedSlots);
+		collect_candidate_pairs_internal(t->southWest, pairs, leafAABB, sharedSlots);
+		return;
+	}
+
+	int amtElements = t->element_start.size();
+	int amtShared = t->shared_element_start.size();
+
+	if (amtElements + amtShared < 2)
+	{
+		return;
+	}
+
+	if (sharedSlots != nullptr)
+	{
+		for (int i = 0; i < amtShared; i++)
+		{
+			sharedSlots->push_back({t, i, true});
+		}
+	}
+
+	// AABBs of all elements of this leaf node (elements which fit completely into the node first, then the shared elements)
+	leafAABB.clear();
+
+	for (int i = 0; i < amtElements; i++)
+	{
+		leafAABB.push_back(genAABBBox(t->element_start[i], t->element_amount[i]));
+	}
+
+	for (int i = 0; i < amtShared; i++)
+	{
+		leafAABB.push_back(genAABBBox(t->shared_element_start[i], t->shared_element_amount[i]));
+	}
+
+	auto start_of  = [t, amtElements](int i) { return (i < amtElements) ? t->element_start[i]  : t->shared_element_start[i-amtElements]; };
+	auto amount_of = [t, amtElements](int i) { return (i < amtElements) ? t->element_amount[i] : t->shared_element_amount[i-amtElements]; };
+
+	Scalar rootxmin = boundary2.cx-boundary2.dim;
+	Scalar rootymin = boundary2.cy-boundary2.dim;
+
+	Scalar xmin = t->boundary2.cx-t->boundary2.dim;
+	Scalar xmax = t->boundary2.cx+t->boundary2.dim;
+	Scalar ymin = t->boundary2.cy-t->boundary2.dim;
+	Scalar ymax = t->boundary2.cy+t->boundary2.dim;
+
+	for (int i = 0; i < amtElements+amtShared; i++)
+	{
+		// exact overlap tests: two shared elements are paired by collect_candidate_pairs_shared()
+		if ((i >= amtElements) and (sharedSlots != nullptr))
+		{
+			break;
+		}
+
+		for (int k = i+1; k < amtElements+amtShared; k++)
+		{
+			// lower left and upper right corner of the intersection of both AABBs
+			Scalar px = std::max(std::get<0>(leafAABB[i]), std::get<0>(leafAABB[k]));
+			Scalar py = std::max(std::get<2>(leafAABB[i]), std::get<2>(leafAABB[k]));
+			Scalar qx = std::min(std::get<1>(leafAABB[i]), std::get<1>(leafAABB[k]));
+			Scalar qy = std::min(std::get<3>(leafAABB[i]), std::get<3>(leafAABB[k]));
+
+			// AABBs do not overlap -> no candidate
+			if ((px > qx) or (py > qy))
+			{
+				continue;
+			}
+
+			int startA = start_of(i);
+			int startB = start_of(k);
+
+			// Elements which fit completely into this leaf node reside in no other leaf node. Two shared elements reside together in all leaf nodes overlapping the intersection of their AABBs -> the pair is only emitted by the leaf node containing the lower left corner of this intersection (clamped to the root node). An intersection of zero width (or height) only overlaps the leaf node (xmin, xmax] (see BasicBoundaryBox::overlaps).
+			if (k >= amtElements)
+			{
+				bool flatX = (px == qx);
+				bool flatY = (py == qy);
+
+				px = std::max(px, rootxmin);
+				py = std::max(py, rootymin);
+
+				bool insideX = flatX ? ((px > xmin) and (px <= xmax)) : ((px >= xmin) and (px < xmax));
+				bool insideY = flatY ? ((py > ymin) and (py <= ymax)) : ((py >= ymin) and (py < ymax));
+
+				if ((i >= amtElements) and ((insideX == false) or (insideY == false)))
+				{
+					continue;
+				}
+			}
+
+			if (startA < startB)
+			{
+				pairs.push_back({startA, amount_of(i), startB, amount_of(k)});
+			}
+			else
+			{
+				pairs.push_back({startB, amount_of(k), startA, amount_of(i)});
+			}
+		}
+	}
+}
+
+// returns every pair of elements residing in a common leaf node with overlapping AABBs exactly once
+template <typename Scalar>
+void BasicQuadtree<Scalar>::collect_candidate_pairs(std::vector<ElementPair> &pairs)
+{
+	QUADTREE_STATS_TIMER(QUADTREE_OP_CANDIDATE_PAIRS);
+
+	pairs.clear();
+
+	// every element resides in a single node: overlapping elements may reside in any two nodes whose (enlarged) bounds overlap
+	if (single_node_storage())
+	{
+		// elements (and their AABBs) of the ancestors of the visited node (reused for all nodes)
+		std::vector<BuildElement> stack;
+
+		collect_candidate_pairs_enclosing(this, pairs, stack, 0, 0, true);
+
+		QUADTREE_STATS_ADD(nodeVisits, queryScratch.nodeVisits);
+		QUADTREE_STATS_ONLY(queryScratch.nodeVisits = 0);
+		return;
+	}
+
+	// AABBs of the elements of a leaf node (reused for all leaf nodes)
+	std::vector< std::tuple<Scalar, Scalar, Scalar, Scalar> > leafAABB;
+
+	// exact overlap tests: the polygons may not overlap the leaf node containing the corner of the intersection of the AABBs of two shared elements -> the shared elements are paired per element
+	if (storageSettings->exactOverlap)
+	{
+		std::vector<ElementSlot> sharedSlots;
+
+		collect_candidate_pairs_internal(this, pairs, leafAABB, &sharedSlots);
+		collect_candidate_pairs_shared(sharedSlots, pairs);
+		return;
+	}
+
+	collect_candidate_pairs_internal(this, pairs, leafAABB, nullptr);
+}
+
+// used by collect_candidate_pairs() with exact overlap tests. The slots are grouped by element, i.e., every element searches all leaf nodes holding it at once and the stamps skip the partners found in a previous leaf node (a pair is emitted by its element with the smaller iStart).
+template <typename Scalar>
+void BasicQuadtree<Scalar>::collect_candidate_pairs_shared(std::vector<ElementSlot> &sharedSlots, std::vector<ElementPair> &pairs)
+{
+	auto start_of = [](const ElementSlot &s) { return s.node->shared_element_start[s.slot]; };
+
+	std::sort(sharedSlots.begin(), sharedSlots.end(), [&start_of](const ElementSlot &a, const ElementSlot &b) { return start_of(a) < start_of(b); });
+
+	int last = 0;
+
+	for (int first = 0; first < (int)sharedSlots.size(); first = last)
+	{
+		int startA = start_of(sharedSlots[first]);
+		int amountA = sharedSlots[first].node->shared_element_amount[sharedSlots[first].slot];
+		auto aabbA = genAABBBox(startA, amountA);
+
+		next_query_epoch(queryScratch);
+
+		for (last = first; (last < (int)sharedSlots.size()) and (start_of(sharedSlots[last]) == startA); last++)
+		{
+			const BasicQuadtree *t = sharedSlots[last].node;
+
+			for (int k = 0; k < (int)t->shared_element_start.size(); k++)
+			{
+				int startB = t->shared_element_start[k];
+
+				if ((startB <= startA) or (queryScratch.stamp[startB] == queryScratch.epoch))
+				{
+					continue;
+				}
+
+				queryScratch.stamp[startB] = queryScratch.epoch;
+
+				auto aabbB = genAABBBox(startB, t->shared_element_amount[k]);
+
+				// AABBs overlap (touching counts)
+				if ((std::get<0>(aabbA) <= std::get<1>(aabbB)) and (std::get<0>(aabbB) <= std::get<1>(aabbA)) and (std::get<2>(aabbA) <= std::get<3>(aabbB)) and (std::get<2>(aabbB) <= std::get<3>(aabbA)))
+				{
+					pairs.push_back({startA, amountA, startB, t->shared_element_amount[k]});
+				}
+			}
+		}
+	}
+}
+
+// used by collect_candidate_pairs() if every element resides in a single node. A pair is emitted by the deeper node of both elements (same node: by the node, sibling subtrees: by collect_candidate_pairs_cross()), stack[first, last) holds the elements of the ancestors of *t whose AABBs touch the parent of *t
+template <typename Scalar>
+void BasicQuadtree<Scalar>::collect_candidate_pairs_enclosing(const BasicQuadtree *t, std::vector<ElementPair> &pairs, std::vector<BuildElement> &stack, int first, int last, bool withinSubtree)
+{
+	QUADTREE_STATS_ONLY(queryScratch.nodeVisits++);
+
+	// bounds of the node (enlarged for loose bounds, see set_storage()). Every element of the subtree fits into them, i.e., an element not touching them overlaps none of the elements of the subtree
+	Real looseDim = loose_dim(t);
+	Real bxmin = t->boundary2.cx-looseDim;
+	Real bxmax = t->boundary2.cx+looseDim;
+	Real bymin = t->boundary2.cy-looseDim;
+	Real bymax = t->boundary2.cy+looseDim;
+
+	int begin = stack.size();
+
+	for (int i = first; i < last; i++)
+	{
+		BuildElement e = stack[i];
+
+		if ((e.xmax >= bxmin) and (e.xmin <= bxmax) and (e.ymax >= bymin) and (e.ymin <= bymax))
+		{
+			stack.push_back(e);
+		}
+	}
+
+	int end = stack.size();
+
+	for (int i = 0; i < (int)t->element_start.size(); i++)
+	{
+		auto returnAABB = genAABBBox(t->element_start[i], t->element_amount[i]);
+		BuildElement e = {std::get<0>(returnAABB), std::get<1>(returnAABB), std::get<2>(returnAABB), std::get<3>(returnAABB), t->element_start[i], t->element_amount[i]};
+
+		// candidates: the elements of the ancestors (and the elements of this node added before)
+		int amtCandidates = withinSubtree ? stack.size() : end;
+
+		for (int k = begin; k < amtCandidates; k++)
+		{
+			const BuildElement &other = stack[k];
+
+			// AABBs overlap (touching counts)
+			if ((e.xmin <= other.xmax) and (other.xmin <= e.xmax) and (e.ymin <= other.ymax) and (other.ymin <= e.ymax))
+			{
+				if (e.iStart < other.iStart)
+				{
+					pairs.push_back({e.iStart, e.iAmount, other.iStart, other.iAmount});
+				}
+				else
+				{
+					pairs.push_back({other.iStart, other.iAmount, e.iStart, e.iAmount});
+				}
+			}
+		}
+
+		if (withinSubtree)
+		{
+			stack.push_back(e);
+		}
+	}
+
+	if (t->northWest != nullptr)	// this node has been split yet -> != nullptr
+	{
+		const BasicQuadtree *children[4] = {t->northEast, t->northWest, t->southEast, t->southWest};
+		int amtStack = stack.size();
+
+		for (int c = 0; c < 4; c++)
+		{
+			collect_candidate_pairs_enclosing(children[c], pairs, stack, begin, amtStack, withinSubtree);
+		}
+
+		// the exact bounds of the children only touch each other, the loose bounds overlap
+		if (withinSubtree and (storageSettings->looseness > 1))
+		{
+			for (int c = 0; c < 4; c++)
+			{
+				for (int d = c+1; d < 4; d++)
+				{
+					collect_candidate_pairs_cross(children[c], children[d], pairs, stack);
+				}
+			}
+		}
+	}
+
+	stack.resize(begin);
+}
+
+// used by collect_candidate_pairs_enclosing()
+template <typename Scalar>
+void BasicQuadtree<Scalar>::collect_candidate_pairs_cross(const BasicQuadtree *a, const BasicQuadtree *b, std::vector<ElementPair> &pairs, std::vector<BuildElement> &stack)
+{
+	Real looseDimA = loose_dim(a);
+	Real looseDimB = loose_dim(b);
+
+	// the loose bounds do not touch -> no pairs
+	if ((a->boundary2.cx+looseDimA < b->boundary2.cx-looseDimB) or (b->boundary2.cx+looseDimB < a->boundary2.cx-looseDimA) or (a->boundary2.cy+looseDimA < b->boundary2.cy-looseDimB) or (b->boundary2.cy+looseDimB < a->boundary2.cy-looseDimA))
+	{
+		return;
+	}
+
+	// the elements of *a with the subtree of *b
+	int begin = stack.size();
+
+	for (int i = 0; i < (int)a->element_start.size(); i++)
+	{
+		auto returnAABB = genAABBBox(a->element_start[i], a->element_amount[i]);
+		stack.push_back({std::get<0>(returnAABB), std::get<1>(returnAABB), std::get<2>(returnAABB), std::get<3>(returnAABB), a->element_start[i], a->element_amount[i]});
+	}
+
+	int end = stack.size();
+
+	if (end > begin)
+	{
+		collect_candidate_pairs_enclosing(b, pairs, stack, begin, end, false);
+	}
+
+	stack.resize(begin);
+
+	// the subtrees of the children of *a with the subtree of *b
+	if (a->northWest != nullptr)	// this node has been split yet -> != nullptr
+	{
+		collect_candidate_pairs_cross(a->northEast, b, pairs, stack);
+		collect_candidate_pairs_cross(a->northWest, b, pairs, stack);
+		collect_candidate_pairs_cross(a->southEast, b, pairs, stack);
+		collect_candidate_pairs_cross(a->southWest, b, pairs, stack);
+	}
+}
+
+
+// recursively insert a element into all leaf nodes (deepest nodes possible) of a given node (*t)
+template <typename Scalar>
+void BasicQuadtree<Scalar>::test2(BasicQuadtree* t, Scalar xmin, Scalar xmax, Scalar ymin, Scalar ymax, int iStart, int iAmount)
+{
+	// collision if (exact overlap tests: the polygon of the element has to overlap the node as well):
+	if (element_overlaps_node(t, xmin, xmax, ymin, ymax, iStart, iAmount))
+	{
+		if (t->northWest != nullptr)	// this node has been split yet -> != nullptr
+		{
+			test2(t->northEast, xmin, xmax, ymin, ymax, iStart, iAmount);
+			test2(t->northWest, xmin, xmax, ymin, ymax, iStart, iAmount);
+			test2(t->southEast, xmin, xmax, ymin, ymax, iStart, iAmount);
+			test2(t->southWest, xmin, xmax, ymin, ymax, iStart, iAmount);
+		}
+		else	// deepest node possible
+		{
+			push_element(t, iStart, iAmount, true);
+
+			QUADTREE_STATS_ADD(sharedInserts, 1);
+		}
+	}
+	// no collision
+	else
+	{
+	}
+}
+
+
+// the polygon of an element overlaps the (closed) box of a node
+template <typename Scalar>
+bool BasicQuadtree<Scalar>::polygon_overlaps_node(const BasicQuadtree *t, int iStart, int iAmount) const
+{
+	RegionPolygon<Scalar, Real> polygon;
+	polygon.x = ptrToX->data()+iStart;
+	polygon.y = ptrToY->data()+iStart;
+	polygon.amount = iAmount;
+
+	Real bxmin = (Real)t->boundary2.cx-t->boundary2.dim;
+	Real bxmax = (Real)t->boundary2.cx+t->boundary2.dim;
+	Real bymin = (Real)t->boundary2.cy-t->boundary2.dim;
+	Real bymax = (Real)t->boundary2.cy+t->boundary2.dim;
+
+	// the node lies inside the polygon or the boundary of the polygon passes through the node (the t-values of a border are the same for all nodes sharing it, i.e., an element overlapping a node always overlaps one of its children nodes)
+	return polygon.inside(bxmin, bymin) or polygon.edge_touches(bxmin, bxmax, bymin, bymax);
+}
+
+
+// deepest node of the subtree of *t enclosing the AABB boundary box of an element (with the enlarged bounds for loose bounds), i.e., the node in which the element resides
+template <typename Scalar>
+BasicQuadtree<Scalar> *BasicQuadtree<Scalar>::fetch_enclosing_node(BasicQuadtree *t, Scalar xmin, Scalar xmax, Scalar ymin, Scalar ymax) const
+{
+	// center of the AABB boundary box (doubled, no overflow for integer coordinates)
+	Real centerx = (Real)xmin + (Real)xmax;
+	Real centery = (Real)ymin + (Real)ymax;
+
+	while (t->northWest != nullptr)
+	{
+		// children node (0: NW, 1: NE, 2: SW, 3: SE) containing the center
+		int quadrant = (centerx > 2*(Real)t->boundary2.cx) + 2*(centery <= 2*(Real)t->boundary2.cy);
+		BasicQuadtree *child = &t->northWest[quadrant];
+
+		// the element does not fit into the enlarged child node -> it resides in this node
+		if (child->boundary2.contains_loose(xmin, xmax, ymin, ymax, loose_dim(child)) == false)
+		{
+			break;
+		}
+
+		t = child;
+	}
+
+	return t;
+}
+
+// insert an element into the deepest node of the subtree of *t enclosing it
+template <typename Scalar>
+void BasicQuadtree<Scalar>::insert_enclosing(BasicQuadtree *t, Scalar xmin, Scalar xmax, Scalar ymin, Scalar ymax, int iStart, int iAmount)
+{
+	t = fetch_enclosing_node(t, xmin, xmax, ymin, ymax);
+
+	// there is room in the node (or the maximum depth has been reached) -> the element resides in this node
+	if ((t->northWest != nullptr) or (t->element_start.size() < maxAmtElements) or (t->nodeDepth == maxDepth))
+	{
+		push_element(t, iStart, iAmount, false);
+		return;
+	}
+
+	// full leaf node -> split it and sort its elements into the children nodes (the elements which fit into none of the children stay in the node)
+	if (t->subdivide() == false)
+	{
+		std::cout << "SUB DIV RETURN FALSE" << std::endl;
+		exit(1);
+	}
+
+	unindex_node(t);
+
+	std::vector<int> reshuf_element_start;
+	std::vector<int> reshuf_element_amount;
+
+	reshuf_element_start.swap(t->element_start);
+	reshuf_element_amount.swap(t->element_amount);
+
+	for (int i = 0; i < (int)reshuf_element_start.size(); i++)
+	{
+		auto returnAABB = genAABBBox(reshuf_element_start[i], reshuf_element_amount[i]);
+
+		insert_enclosing(t, std::get<0>(returnAABB), std::get<1>(returnAABB), std::get<2>(returnAABB), std::get<3>(returnAABB), reshuf_element_start[i], reshuf_element_amount[i]);
+	}
+
+	insert_enclosing(t, xmin, xmax, ymin, ymax, iStart, iAmount);
+}
+
+// select the storage of the elements (empty tree only)
+template <typename Scalar>
+bool BasicQuadtree<Scalar>::set_storage(QuadtreeStorage policy, Real looseness)
+{
+	if ((this != this->parent) or ((policy == QUADTREE_STORAGE_LOOSE) and (looseness < 1)))
+	{
+		return false;
+	}
+
+	if ((northWest != nullptr) or (element_start.empty() == false) or (shared_element_start.empty() == false))
+	{
+		std::cout << "set_storage -> the tree has to be empty" << std::endl;
+		return false;
+	}
+
+	if ((policy != QUADTREE_STORAGE_SHARED) and storageSettings->exactOverlap)
+	{
+		std::cout << "set_storage -> exact overlap tests require the shared storage" << std::endl;
+		return false;
+	}
+
+	storageSettings->policy = policy;
+	storageSettings->looseness = (policy == QUADTREE_STORAGE_LOOSE) ? looseness : 1;
+
+	return true;
+}
+
+// switch between exact and loose bounds (empty tree only)
+template <typename Scalar>
+bool BasicQuadtree<Scalar>::set_loose_bounds(Real looseness)
+{
+	if (looseness < 1)
+	{
+		return false;
+	}
+
+	return set_storage((looseness > 1) ? QUADTREE_STORAGE_LOOSE : QUADTREE_STORAGE_SHARED, looseness);
+}
+
+// route the shared elements by their polygon instead of their AABB boundary box (empty tree only)
+template <typename Scalar>
+bool BasicQuadtree<Scalar>::set_exact_overlap(bool enable)
+{
+	if (this != this->parent)
+	{
+		return false;
+	}
+
+	if ((northWest != nullptr) or (element_start.empty() == false) or (shared_element_start.empty() == false))
+	{
+		std::cout << "set_exact_overlap -> the tree has to be empty" << std::endl;
+		return false;
+	}
+
+	if (enable and single_node_storage())
+	{
+		std::cout << "set_exact_overlap -> exact overlap tests require the shared storage" << std::endl;
+		return false;
+	}
+
+	storageSettings->exactOverlap = enable;
+
+	return true;
+}
+
+
+// insert one point into the tree. Split the tree and relocate the points ot the node if necessary
+template <typename Scalar>
+bool BasicQuadtree<Scalar>::insert(int iStart, int iAmount)
+{
+	QUADTREE_STATS_TIMER(QUADTREE_OP_INSERT);
+
+	versions->elements++;
+
+	// generate the AABB boundary box (the cache is refreshed whenever an element is inserted from the root node)
+	auto returnAABB = (this == this->parent) ? refresh_AABB(iStart, iAmount) : genAABBBox(iStart, iAmount);
+	Scalar xmin = std::get<0>(returnAABB);
+	Scalar xmax = std::get<1>(returnAABB);
+	Scalar ymin = std::get<2>(returnAABB);
+	Scalar ymax = std::get<3>(returnAABB);
+
+	// every element resides in a single node (elements residing partially inside the root node are kept by the root node)
+	if (single_node_storage())
+	{
+		if ((this == this->parent) and (boundary2.contains(xmin, xmax, ymin, ymax) == false) and (count_points_inside(ptrToX->data()+iStart, ptrToY->data()+iStart, iAmount, boundary2.cx-boundary2.dim, boundary2.cx+boundary2.dim, boundary2.cy-boundary2.dim, boundary2.cy+boundary2.dim) == 0))
+		{
+			forget_AABB(iStart);
+			return false;
+		}
+
+		insert_enclosing(this, xmin, xmax, ymin, ymax, iStart, iAmount);
+		return true;
+	}
+
+	// check if all the element can be fit completely into the node (the AABB boundary box resides inside the node)
+	if (boundary2.contains(xmin, xmax, ymin, ymax) == false)
+	{
+		// The element fits completely into the parent node. If it overlaps this node, it does not fit into any sibling node either -> go one up, because the insert would only insert into the deepest node it searches (e.g. southEast but the element does NOT fit into southEast completely, so insert it into all sibling nodes)
+		if (this != this->parent)
+		{
+			if ((xmax > boundary2.cx-boundary2.dim) and (xmin <= boundary2.cx+boundary2.dim) and (ymax > boundary2.cy-boundary2.dim) and (ymin <= boundary2.cy+boundary2.dim))
+			{
+				test2(this->parent, xmin, xmax, ymin, ymax, iStart, iAmount);
+				return true;
+			}
+
+			return false;
+		}
+
+		int count_inside = count_points_inside(ptrToX->data()+iStart, ptrToY->data()+iStart, iAmount, boundary2.cx-boundary2.dim, boundary2.cx+boundary2.dim, boundary2.cy-boundary2.dim, boundary2.cy+boundary2.dim);
+
+		// object lies completely outside of the root node (exact overlap tests: all points may lie outside while part of the area of the polygon is inside the root node)
+		if ((count_inside == 0) and ((storageSettings->exactOverlap == false) or (element_overlaps_node(this, xmin, xmax, ymin, ymax, iStart, iAmount) == false)))
+		{
+// 			std::cout << "\033[1;31m" << "Object completely outside of rootnode!!!" << "\033[0m\n";
+			forget_AABB(iStart);
+			return false;
+		}
+
+		// insert recursively
+		test2(this, xmin, xmax, ymin, ymax, iStart, iAmount);
+
+		return true;
+	}
+
+	if ((element_start.size() < maxAmtElements and northWest == nullptr) or this->nodeDepth == maxDepth)	// there is room in the node for this pt. Insert the point only if there is no children node available to sort into or if the maximum depth allowed has been reached
+	{
+        //std::cout << "Miau" << std::endl;
+		push_element(this, iStart, iAmount, false);
+		return true;
+	}
+
+	// maximum amount of pts in this node reached -> split into 4 new nodes
+	if (northWest == nullptr)	// this node has not been split yet -> nullptr
+	{
+		bool sub_ret = subdivide();
+		if (sub_ret == false)
+		{
+			std::cout << "SUB DIV RETURN FALSE" << std::endl;
+			exit(1);
+		}
+
+		// the elements of this node are moved into the children nodes
+		unindex_node(this);
+
+		// shuffle all elements which fit into a node completely
+		// remove all points from the parent node, and sort this points into the child nodes
+		// TODO: dont insert into root node -> insert into this ?!
+		for (int i = 0; i < (int)element_start.size(); i++)
+		{
+			insert(element_start[i], element_amount[i]);
+		}
+
+		element_start.clear();
+		element_amount.clear();
+
+		// shuffle all shared elements
+		for (int i = 0; i < (int)shared_element_start.size(); i++)
+		{
+			// generate the AABB boundary box
+			auto returnAABB = genAABBBox(shared_element_start[i], shared_element_amount[i]);
+			Scalar xmin = std::get<0>(returnAABB);
+			Scalar xmax = std::get<1>(returnAABB);
+			Scalar ymin = std::get<2>(returnAABB);
+			Scalar ymax = std::get<3>(returnAABB);
+
+			test2(this, xmin, xmax, ymin, ymax, shared_element_start[i], shared_element_amount[i]);
+		}
+
+		shared_element_start.clear();
+		shared_element_amount.clear();
+	}
+
+	// integer coordinates: the boundaries of the children nodes are exact -> select the child node directly (an element straddling the center resides in the shared space of the leaf nodes it overlaps)
+	if constexpr (std::is_integral<Scalar>::value)
+	{
+		int quadrant = boundary2.quadrant(xmin, xmax, ymin, ymax);
+
+		if (quadrant < 0)
+		{
+			test2(this, xmin, xmax, ymin, ymax, iStart, iAmount);
+			return true;
+		}
+
+		return northWest[quadrant].insert(iStart, iAmount);
+	}
+
+	if (northEast->insert(iStart, iAmount)) 
+	{
+		return true;
+	}
+	
+	if (northWest->insert(iStart, iAmount))
+	{
+		return true;
+	}
+	
+	if (southWest->insert(iStart, iAmount))
+	{
+		return true;
+	}
+
+	if (southEast->insert(iStart, iAmount))
+	{
+		return true;
+	}
+
+	return false;
+}
+
+
+// auxiliary function used by build(). Sorts the elements elements[first, last) (which all fit completely into the node *t) into the subtree of *t
+template <typename Scalar>
+void BasicQuadtree<Scalar>::build_internal(BasicQuadtree *t, std::vector<BuildElement> &elements, std::vector<BuildElement> &scratch, std::vector<unsigned char> &bucket, int first, int last, BuildSchedule *schedule)
+{
+	// the node is not split by insert() as long as it inherits no more than maxAmtElements elements (or the maximum depth has been reached)
+	if (((unsigned int)(last-first) <= maxAmtElements) or (t->nodeDepth == maxDepth))
+	{
+		for (int i = first; i < last; i++)
+		{
+			push_element(t, elements[i].iStart, elements[i].iAmount, false);
+		}
+
+		return;
+	}
+
+	// the subtree is built later by a worker thread
+	if ((schedule != nullptr) and (t->nodeDepth == schedule->taskDepth))
+	{
+		schedule->subtrees.push_back({t, first, last});
+		return;
+	}
+
+	bool sub_ret = t->subdivide();
+	if (sub_ret == false)
+	{
+		std::cout << "build -> SUB DIV RETURN FALSE" << std::endl;
+		exit(1);
+	}
+
+	// children in the order used by insert() (NE, NW, SW, SE). The last bucket holds the elements which do not fit into a single child node (shared space)
+	BasicQuadtree *children[4] = {t->northEast, t->northWest, t->southWest, t->southEast};
+	int bucketSize[5] = {0, 0, 0, 0, 0};
+
+	// boundaries of the children nodes
+	Scalar cxmin[4], cxmax[4], cymin[4], cymax[4];
+
+	for (int k = 0; k < 4; k++)
+	{
+		cxmin[k] = children[k]->boundary2.cx - children[k]->boundary2.dim;
+		cxmax[k] = children[k]->boundary2.cx + children[k]->boundary2.dim;
+		cymin[k] = children[k]->boundary2.cy - children[k]->boundary2.dim;
+		cymax[k] = children[k]->boundary2.cy + children[k]->boundary2.dim;
+	}
+
+	// determine the child node for every element. Fitting the AABB into the node is equivalent to fitting all points of the element into the node.
+	for (int i = first; i < last; i++)
+	{
+		const BuildElement &e = elements[i];
+
+		// evaluate all four children without branching (the random distribution of the elements renders branches unpredictable) and pick the first fitting child
+		unsigned int fits = 0;
+
+		for (int k = 0; k < 4; k++)
+		{
+			fits |= (unsigned int)((e.xmin > cxmin[k]) & (e.xmax <= cxmax[k]) & (e.ymin > cymin[k]) & (e.ymax <= cymax[k])) << k;
+		}
+
+		static const unsigned char firstFit[16] = {4, 0, 1, 0, 2, 0, 1, 0, 3, 0, 1, 0, 2, 0, 1, 0};
+		unsigned char b = firstFit[fits];
+
+		bucket[i] = b;
+		bucketSize[b]++;
+	}
+
+	// stable counting sort of elements[first, last) into the five buckets
+	int bucketStart[6];
+	bucketStart[0] = first;
+
+	for (int k = 0; k < 5; k++)
+	{
+		bucketStart[k+1] = bucketStart[k] + bucketSize[k];
+	}
+
+	int fill[5] = {bucketStart[0], bucketStart[1], bucketStart[2], bucketStart[3], bucketStart[4]};
+
+	for (int i = first; i < last; i++)
+	{
+		scratch[fill[bucket[i]]++] = elements[i];
+	}
+
+	std::copy(scratch.begin()+first, scratch.begin()+last, elements.begin()+first);
+
+	for (int k = 0; k < 4; k++)
 	{
-		if (t->northWest != nullptr)	// this node has been split yet -> != nullptr
-		{
-			test2(t->northEast, xmin, xmax, ymin, ymax, iStart, iAmount);
-			test2(t->northWest, xmin, xmax, ymin, ymax, iStart, iAmount);
-			test2(t->southEast, xmin, xmax, ymin, ymax, iStart, iAmount);
-			test2(t->southWest, xmin, xmax, ymin, ymax, iStart, iAmount);
-		}
-		else	// deepest node possible
-		{
-			t->shared_element_start.push_back(iStart);
-			t->shared_element_amount.push_back(iAmount);
-		}
+		build_internal(children[k], elements, scratch, bucket, bucketStart[k], bucketStart[k+1], schedule);
 	}
-	// no collision
-	else
+
+	// the subtree is not complete yet
+	if (schedule != nullptr)
+	{
+		schedule->shared.push_back({t, bucketStart[4], bucketStart[5]});
+		return;
+	}
+
+	// the subtree is complete -> move the shared elements into its leaf nodes
+	for (int i = bucketStart[4]; i < bucketStart[5]; i++)
 	{
+		test2(t, elements[i].xmin, elements[i].xmax, elements[i].ymin, elements[i].ymax, elements[i].iStart, elements[i].iAmount);
 	}
 }
 
 
-// insert one point into the tree. Split the tree and relocate the points ot the node if necessary
-bool Quadtree::insert(int iStart, int iAmount)
+// bulk-load the tree from a complete list of elements (iStart, iAmount)
+template <typename Scalar>
+bool BasicQuadtree<Scalar>::build(const std::vector< std::pair<int, int> > &elements, int threadCount)
 {
-	int count_inside = iAmount;
+	QUADTREE_STATS_TIMER(QUADTREE_OP_BUILD);
 
-	// TODO: catch cases, where all points of the polygon lies outside of the node but part of the area of the polygon still is inside the QT)
-	// check if all the element can be fit completely into the node
- 	for (int i = iStart; i < (iStart+iAmount); i++)
+	versions->elements++;
+
+	if (this != this->parent)
 	{
- 		if ((*ptrToX)[i] > boundary2->cx+boundary2->dim or (*ptrToX)[i] <= boundary2->cx-boundary2->dim or (*ptrToY)[i] > boundary2->cy+boundary2->dim or (*ptrToY)[i] <= boundary2->cy-boundary2->dim)
-		{
-			count_inside--;
-		}
+		std::cout << "build -> has to be called on the root node" << std::endl;
+		return false;
 	}
 
-	// object lies completely outside of the root node
-	if ((count_inside == 0) and (this == this->parent))
+	if (threadCount <= 0)
 	{
-// 		std::cout << "\033[1;31m" << "Object completely outside of rootnode!!!" << "\033[0m\n";
-		return false;
+		threadCount = std::max(1, (int)std::thread::hardware_concurrency());
+	}
+
+	// start from an empty tree
+	clearNode();
+
+	if (elementIndex != nullptr)
+	{
+		elementIndex->clear();
 	}
 
-	if (count_inside < iAmount)
+	element_start.clear();
+	element_amount.clear();
+	shared_element_start.clear();
+	shared_element_amount.clear();
+
+	// every element resides in a single node: the elements are sorted into the tree one by one (serially, same tree as insert())
+	if (single_node_storage())
 	{
-		if (count_inside > 0)
+		bool allInserted = true;
+
+		for (int i = 0; i < (int)elements.size(); i++)
 		{
-			// generate the AABB boundary box
-			auto returnAABB = genAABBBox(iStart, iAmount);
-			float xmin = std::get<0>(returnAABB);
-			float xmax = std::get<1>(returnAABB);
-			float ymin = std::get<2>(returnAABB);
-			float ymax = std::get<3>(returnAABB);
-
-			// insert recursively
-			if (this == this->parent)
-			{
-				test2(this, xmin, xmax, ymin, ymax, iStart, iAmount);
+			auto returnAABB = refresh_AABB(elements[i].first, elements[i].second);
 
-			}
-			else	// go one up, because the insert would only insert into the deepest node it searches (e.g. southEast but the element does NOT fit into southEast completely, so insert it into all sibling nodes)
+			// object lies completely outside of the root node
+			if ((boundary2.contains(std::get<0>(returnAABB), std::get<1>(returnAABB), std::get<2>(returnAABB), std::get<3>(returnAABB)) == false) and (count_points_inside(ptrToX->data()+elements[i].first, ptrToY->data()+elements[i].first, elements[i].second, boundary2.cx-boundary2.dim, boundary2.cx+boundary2.dim, boundary2.cy-boundary2.dim, boundary2.cy+boundary2.dim) == 0))
 			{
-				test2(this->parent, xmin, xmax, ymin, ymax, iStart, iAmount);
+				forget_AABB(elements[i].first);
+				allInserted = false;
+				continue;
 			}
 
-			return true;
+			insert_enclosing(this, std::get<0>(returnAABB), std::get<1>(returnAABB), std::get<2>(returnAABB), std::get<3>(returnAABB), elements[i].first, elements[i].second);
 		}
 
-		return false;
+		return allInserted;
 	}
 
-	if ((element_start.size() < maxAmtElements and northWest == nullptr) or this->nodeDepth == maxDepth)	// there is room in the node for this pt. Insert the point only if there is no children node available to sort into or if the maximum depth allowed has been reached
+	// elements residing completely inside the root node, and elements residing only partially inside the root node
+	std::vector<BuildElement> inside;
+	std::vector<BuildElement> sharedRoot;
+	bool allInserted = true;
+
+	inside.reserve(elements.size());
+
+	for (int i = 0; i < (int)elements.size(); i++)
 	{
-        //std::cout << "Miau" << std::endl;
-		element_start.push_back(iStart);
-		element_amount.push_back(iAmount);
-		return true;
+		auto returnAABB = refresh_AABB(elements[i].first, elements[i].second);
+
+		BuildElement e;
+		e.xmin = std::get<0>(returnAABB);
+		e.xmax = std::get<1>(returnAABB);
+		e.ymin = std::get<2>(returnAABB);
+		e.ymax = std::get<3>(returnAABB);
+		e.iStart = elements[i].first;
+		e.iAmount = elements[i].second;
+
+		if (boundary2.contains(e.xmin, e.xmax, e.ymin, e.ymax))
+		{
+			inside.push_back(e);
+			continue;
+		}
+
+		int count_inside = count_points_inside(ptrToX->data()+e.iStart, ptrToY->data()+e.iStart, e.iAmount, boundary2.cx-boundary2.dim, boundary2.cx+boundary2.dim, boundary2.cy-boundary2.dim, boundary2.cy+boundary2.dim);
+
+		// object lies completely outside of the root node (exact overlap tests: see insert())
+		if ((count_inside == 0) and ((storageSettings->exactOverlap == false) or (element_overlaps_node(this, e.xmin, e.xmax, e.ymin, e.ymax, e.iStart, e.iAmount) == false)))
+		{
+			forget_AABB(e.iStart);
+			allInserted = false;
+		}
+		else
+		{
+			sharedRoot.push_back(e);
+		}
 	}
 
-	// maximum amount of pts in this node reached -> split into 4 new nodes
-	if (northWest == nullptr)	// this node has not been split yet -> nullptr
+	std::vector<BuildElement> scratch(inside.size());
+	std::vector<unsigned char> bucket(inside.size());
+
+	if (threadCount == 1)
 	{
-		bool sub_ret = subdivide();
-		if (sub_ret == false)
+		build_internal(this, inside, scratch, bucket, 0, inside.size());
+	}
+	else
+	{
+		// the reverse index is not thread-safe -> rebuilt after the tree is complete
+		bool rebuildIndex = (elementIndex != nullptr);
+
+		if (rebuildIndex)
 		{
-			std::cout << "SUB DIV RETURN FALSE" << std::endl;
-			exit(1);
+			ownedElementIndex.reset();
+			elementIndex = nullptr;
 		}
 
-		// shuffle all elements which fit into a node completely
-		// remove all points from the parent node, and sort this points into the child nodes
-		// TODO: dont insert into root node -> insert into this ?!
-		for (int i = 0; i < (int)element_start.size(); i++)
+		// split the upper levels serially until there are enough subtrees to balance the load (about eight per thread)
+		BuildSchedule schedule;
+		schedule.taskDepth = 0;
+
+		while ((schedule.taskDepth < maxDepth) and ((1 << (2*schedule.taskDepth)) < 8*threadCount))
 		{
-			insert(element_start[i], element_amount[i]);
+			schedule.taskDepth++;
 		}
 
-		element_start.clear();
-		element_amount.clear();
+		build_internal(this, inside, scratch, bucket, 0, inside.size(), &schedule);
 
-		// shuffle all shared elements
-		for (int i = 0; i < (int)shared_element_start.size(); i++)
+		// largest subtrees first (the subtrees are disjoint -> the order does not change the tree)
+		std::sort(schedule.subtrees.begin(), schedule.subtrees.end(), [](const BuildTask &a, const BuildTask &b) { return (a.last-a.first) > (b.last-b.first); });
+
+		std::atomic<int> nextTask(0);
+
+		auto worker = [&]()
 		{
-			// generate the AABB boundary box
-			auto returnAABB = genAABBBox(shared_element_start[i], shared_element_amount[i]);
-			float xmin = std::get<0>(returnAABB);
-			float xmax = std::get<1>(returnAABB);
-			float ymin = std::get<2>(returnAABB);
-			float ymax = std::get<3>(returnAABB);
+			for (int i = nextTask++; i < (int)schedule.subtrees.size(); i = nextTask++)
+			{
+				const BuildTask &task = schedule.subtrees[i];
+				build_internal(task.node, inside, scratch, bucket, task.first, task.last);
+			}
+		};
 
-			test2(this, xmin, xmax, ymin, ymax, shared_element_start[i], shared_element_amount[i]);
+		std::vector<std::thread> threads;
+
+		for (int i = 1; i < threadCount; i++)
+		{
+			threads.emplace_back(worker);
 		}
 
-		shared_element_start.clear();
-		shared_element_amount.clear();
-	}
+		worker();
 
-	if (northEast->insert(iStart, iAmount)) 
-	{
-		return true;
-	}
-	
-	if (northWest->insert(iStart, iAmount))
-	{
-		return true;
-	}
-	
-	if (southWest->insert(iStart, iAmount))
-	{
-		return true;
+		for (auto &thread : threads)
+		{
+			thread.join();
+		}
+
+		// shared elements of the upper levels (children before their parents, as in the serial build)
+		for (const BuildTask &task : schedule.shared)
+		{
+			for (int i = task.first; i < task.last; i++)
+			{
+				test2(task.node, inside[i].xmin, inside[i].xmax, inside[i].ymin, inside[i].ymax, inside[i].iStart, inside[i].iAmount);
+			}
+		}
+
+		if (rebuildIndex)
+		{
+			enable_element_index();
+		}
 	}
 
-	if (southEast->insert(iStart, iAmount))
+	// elements which reside only partially inside the root node are inserted into the shared space of all leaf nodes they overlap
+	for (int i = 0; i < (int)sharedRoot.size(); i++)
 	{
-		return true;
+		test2(this, sharedRoot[i].xmin, sharedRoot[i].xmax, sharedRoot[i].ymin, sharedRoot[i].ymax, sharedRoot[i].iStart, sharedRoot[i].iAmount);
 	}
 
-	return false;
+	return allInserted;
 }
 
 // split the current node into four new (children)nodes (increment depth by one)
-bool Quadtree::subdivide()
+template <typename Scalar>
+bool BasicQuadtree<Scalar>::subdivide()
 {
 	if (this->nodeDepth < maxDepth)	// split the node only if the maximum depth has not been reached yet
 	{
-		// subdivide NW
-		std::shared_ptr<BoundaryBox> BB_init_NW(new BoundaryBox(boundary2->cx-boundary2->dim*0.5, boundary2->cy+boundary2->dim*0.5, boundary2->dim*0.5));
-		northWest = new Quadtree(std::move(BB_init_NW), this, this->nodeDepth+1);
+		// memory for the four children nodes (single contiguous block)
+		void *block;
 
-		// subdivide NE
-		std::shared_ptr<BoundaryBox> BB_init_NE(new BoundaryBox(boundary2->cx+boundary2->dim*0.5, boundary2->cy+boundary2->dim*0.5, boundary2->dim*0.5));
-		northEast = new Quadtree(std::move(BB_init_NE), this, this->nodeDepth+1);
+		if (nodePool != nullptr)
+		{
+			block = nodePool->allocate_block();
+		}
+		else
+		{
+			block = ::operator new(4*sizeof(BasicQuadtree));
+		}
 
-		// subdivide SE
-		std::shared_ptr<BoundaryBox> BB_init_SE(new BoundaryBox(boundary2->cx+boundary2->dim*0.5, boundary2->cy-boundary2->dim*0.5, boundary2->dim*0.5));
-		southEast = new Quadtree(std::move(BB_init_SE), this, this->nodeDepth+1);
+		BasicQuadtree *children = static_cast<BasicQuadtree *>(block);
 
-		// subdivide SW
-		std::shared_ptr<BoundaryBox> BB_init_SW(new BoundaryBox(boundary2->cx-boundary2->dim*0.5, boundary2->cy-boundary2->dim*0.5, boundary2->dim*0.5));
-		southWest = new Quadtree(std::move(BB_init_SW), this, this->nodeDepth+1);
+		// width of the children nodes (exact for integer coordinates, see the constructor)
+		Scalar half = boundary2.dim/2;
 
-		return true;
-	}
+		// subdivide NW
+		northWest = new (&children[0]) BasicQuadtree(Box(boundary2.cx-half, boundary2.cy+half, half), this, this->nodeDepth+1);
 
-	return false;
-}
+		// subdivide NE
+		northEast = new (&children[1]) BasicQuadtree(Box(boundary2.cx+half, boundary2.cy+half, half), this, this->nodeDepth+1);
 
-// draw the tree using OpenGL
-void Quadtree::traverse_and_draw(Quadtree *t, float widthRootNode)
-{
-	// adjust the height (z-coordinate) of the quadtree
-	float elevate = -10.0;
+		// subdivide SW
+		southWest = new (&children[2]) BasicQuadtree(Box(boundary2.cx-half, boundary2.cy-half, half), this, this->nodeDepth+1);
 
-	// pick the colors according to the depth
-	float depthColor [] = 
-	{
-		1.0f, 0.0f, 0.0f,		// depth 1 = red
-		0.0f, 0.392f, 0.0f,		// depth 2 = darkgreen
-		0.0f, 0.0f, 1.0f,		// depth 3 = blue
-		1.0f, 0.0f, 1.0f,		// depth 4 = purple
-		0.0f, 1.0f, 1.0f, 		// depth 5 = cyan
-		0.294f, 0.0f, 0.51f,	// depth 6 = indigo
-		0.863f, 0.078f, 0.235f,	// depth 6 = Crimson
-	};
+		// subdivide SE
+		southEast = new (&children[3]) BasicQuadtree(Box(boundary2.cx+half, boundary2.cy-half, half), this, this->nodeDepth+1);
 
-	glLineWidth(1.0f);
- 
-	if (t->northEast != nullptr)
-	{
-		colorPick(elevate, t, depthColor, sizeof(depthColor)/sizeof(*depthColor));
-		t->northEast->traverse_and_draw(northEast, widthRootNode);
-	}
+		versions->structure.fetch_add(1, std::memory_order_relaxed);
 
-	if (t->northWest != nullptr)
-	{
-		colorPick(elevate, t, depthColor, sizeof(depthColor)/sizeof(*depthColor));
-		t->northWest->traverse_and_draw(northWest, widthRootNode);
-	}
+		QUADTREE_STATS_ADD(subdivisions, 1);
 
-	if (t->southEast != nullptr)
-	{
-		colorPick(elevate, t, depthColor, sizeof(depthColor)/sizeof(*depthColor));
-		t->southEast->traverse_and_draw(southEast, widthRootNode);
+		return true;
 	}
 
-	if (t->southWest != nullptr)
-	{
-		colorPick(elevate, t, depthColor, sizeof(depthColor)/sizeof(*depthColor));
-		t->southWest->traverse_and_draw(southWest, widthRootNode);
-	}
+	return false;
 }
 
 // count the nodes of the tree
-int Quadtree::count_nodes(Quadtree *t)
+template <typename Scalar>
+int BasicQuadtree<Scalar>::count_nodes(BasicQuadtree *t)
 {
 	// node has been split
 	if (t->northEast != nullptr)
@@ -591,8 +2609,15 @@ int Quadtree::count_nodes(Quadtree *t)
 
 
 // used by count_elements()
-void Quadtree::count_elements_internal(Quadtree* t, std::set< std::pair<int, int> > &count_shared_elements)
+template <typename Scalar>
+void BasicQuadtree<Scalar>::count_elements_internal(BasicQuadtree* t, std::set< std::pair<int, int> > &count_shared_elements)
 {
+	// inner nodes only hold elements if every element resides in a single node
+	for (int i = 0; i < (int)t->element_start.size(); i++)
+	{
+		count_shared_elements.insert(std::make_pair(t->element_start[i], t->element_amount[i]));
+	}
+
 	// node has been split - continue with the recursion
 	if (t->northEast != nullptr)
 	{
@@ -604,11 +2629,6 @@ void Quadtree::count_elements_internal(Quadtree* t, std::set< std::pair<int, int
 	// deepest (child)node possible
 	else
 	{
-		for (int i = 0; i < (int)t->element_start.size(); i++)
-		{
-			count_shared_elements.insert(std::make_pair(t->element_start[i], t->element_amount[i]));
-		}
-
 		for (int ii = 0; ii < (int)t->shared_element_amount.size(); ii++)
 		{
  			count_shared_elements.insert(std::make_pair(t->shared_element_start[ii], t->shared_element_amount[ii]));
@@ -617,8 +2637,22 @@ void Quadtree::count_elements_internal(Quadtree* t, std::set< std::pair<int, int
 }
 
 // count the elements residing in the tree
-int Quadtree::count_elements(Quadtree *t)
+template <typename Scalar>
+int BasicQuadtree<Scalar>::count_elements(BasicQuadtree *t)
 {
+	// every element resides in a single node -> no duplicates to filter out
+	if (single_node_storage())
+	{
+		int amount = 0;
+
+		t->visit_nodes([&amount](const BasicQuadtree &node)
+		{
+			amount += node.element_start.size();
+		});
+
+		return amount;
+	}
+
 	std::set< std::pair<int, int> > count_shared_elements;
 
 	count_elements_internal(t, count_shared_elements);
@@ -627,589 +2661,724 @@ int Quadtree::count_elements(Quadtree *t)
 }
 
 
-// auxiliary function used by delete_element(). Used to collapse nodes and redistribute elements after collapsing.
-void Quadtree::concatenate_nodes(Quadtree *concat_this_node_maybe)
+// auxiliary function used by concatenate_nodes() and collect_garbage(). Moves the elements of the four children nodes of *t into *t and deletes the children, if all four children are leaf nodes holding less elements than the merge threshold. Returns true if the children have been merged.
+template <typename Scalar>
+bool BasicQuadtree<Scalar>::merge_children(BasicQuadtree *t)
 {
-	if (concat_this_node_maybe->parent == concat_this_node_maybe)   // element resides in parent -> do nothing
-	{
-	}
-	else
+	// Concatenate because all four nodes (3 sibling nodes and the one where the element lies) are leaf nodes (deepest nodes possible)
+	if ((t->northEast != nullptr) && (t->northEast->northEast == nullptr) && (t->northWest->northEast == nullptr) && (t->southEast->northEast == nullptr) && (t->southWest->northEast == nullptr))
 	{
-		// Concatenate because all four nodes (3 sibling nodes and the one where the element lies) are leaf nodes (deepest nodes possible)
-        if ((concat_this_node_maybe->parent->northEast->northEast == nullptr) && (concat_this_node_maybe->parent->northWest->northEast == nullptr) && (concat_this_node_maybe->parent->southEast->northEast == nullptr) && (concat_this_node_maybe->parent->southWest->northEast == nullptr))
+		int amtElemntsNE = t->northEast->element_start.size();
+		int amtElemntsNW = t->northWest->element_start.size();
+		int amtElemntsSE = t->southEast->element_start.size();
+		int amtElemntsSW = t->southWest->element_start.size();
+
+		int amtElemntsNE2 = t->northEast->element_amount.size();
+		int amtElemntsNW2 = t->northWest->element_amount.size();
+		int amtElemntsSE2 = t->southEast->element_amount.size();
+		int amtElemntsSW2 = t->southWest->element_amount.size();
+
+		if ((amtElemntsNE != amtElemntsNE2) or (amtElemntsNW != amtElemntsNW2) or (amtElemntsSE != amtElemntsSE2) or (amtElemntsSW != amtElemntsSW2))
 		{
-			int amtElemntsNE = concat_this_node_maybe->parent->northEast->element_start.size();
-			int amtElemntsNW = concat_this_node_maybe->parent->northWest->element_start.size();
-			int amtElemntsSE = concat_this_node_maybe->parent->southEast->element_start.size();
-			int amtElemntsSW = concat_this_node_maybe->parent->southWest->element_start.size();
+			std::cout << "concat -> not eq: " << std::endl;
+			std::cout << amtElemntsNE << "/" << amtElemntsNE2 << "|" << amtElemntsNW << "/" << amtElemntsNW2 << "|" << amtElemntsSE << "/" << amtElemntsSE2 << "|" << amtElemntsSW << "/" << amtElemntsSW2 << std::endl;
+
+			exit(1);
+		}
 
-			int amtElemntsNE2 = concat_this_node_maybe->parent->northEast->element_amount.size();
-			int amtElemntsNW2 = concat_this_node_maybe->parent->northWest->element_amount.size();
-			int amtElemntsSE2 = concat_this_node_maybe->parent->southEast->element_amount.size();
-			int amtElemntsSW2 = concat_this_node_maybe->parent->southWest->element_amount.size();
+		// the elements of the node itself remain in the node (if every element resides in a single node)
+		unsigned int sumElements = amtElemntsNE + amtElemntsNW + amtElemntsSE + amtElemntsSW + t->element_start.size();
 
-			if ((amtElemntsNE != amtElemntsNE2) or (amtElemntsNW != amtElemntsNW2) or (amtElemntsSE != amtElemntsSE2) or (amtElemntsSW != amtElemntsSW2))
+		// move all elements from the leaf nodes into their parents node and delete the leaf nodes (the children are kept as long as they hold at least as many elements as the merge threshold)
+		if (sumElements < mergeSettings->threshold)
+		{
+			// the slots of the leaf nodes are removed from the reverse index (the elements are registered again at the parent node)
+			unindex_node(t->northEast);
+			unindex_node(t->northWest);
+			unindex_node(t->southEast);
+			unindex_node(t->southWest);
+
+			// move element_start and element_amount
+			// move elements from the northEast node to the parent node
+			for (int i = 0; i < amtElemntsNE; i++)
 			{
-				std::cout << "concat -> not eq: " << std::endl;
-				std::cout << amtElemntsNE << "/" << amtElemntsNE2 << "|" << amtElemntsNW << "/" << amtElemntsNW2 << "|" << amtElemntsSE << "/" << amtElemntsSE2 << "|" << amtElemntsSW << "/" << amtElemntsSW2 << std::endl;
+ 				int reshuf_element_start  = t->northEast->element_start[i];
+ 				int reshuf_element_amount = t->northEast->element_amount[i];
 
-				exit(1);
+				push_element(t, reshuf_element_start, reshuf_element_amount, false);
 			}
 
-			unsigned int sumElements = amtElemntsNE + amtElemntsNW + amtElemntsSE + amtElemntsSW;
+			// move elements from the northWest node to the parent node
+			for (int i = 0; i < amtElemntsNW; i++)
+			{
+ 				int reshuf_element_start  = t->northWest->element_start[i];
+ 				int reshuf_element_amount = t->northWest->element_amount[i];
+
+				push_element(t, reshuf_element_start, reshuf_element_amount, false);
+			}
 
-			// move all elements from the leaf nodes into their parents node and delete the leaf nodes
-			if (sumElements < maxAmtElements)
+			// move elements from the southEast node to the parent node
+			for (int i = 0; i < amtElemntsSE; i++)
 			{
-				// move element_start and element_amount
-				// move elements from the northEast node to the parent node
-				for (int i = 0; i < amtElemntsNE; i++)
-				{
- 					int reshuf_element_start  = concat_this_node_maybe->parent->northEast->element_start[i];
- 					int reshuf_element_amount = concat_this_node_maybe->parent->northEast->element_amount[i];
+ 				int reshuf_element_start = t->southEast->element_start[i];
+ 				int reshuf_element_amount = t->southEast->element_amount[i];
 
-					concat_this_node_maybe->parent->element_start.push_back(reshuf_element_start);
-					concat_this_node_maybe->parent->element_amount.push_back(reshuf_element_amount);
-				}
+				push_element(t, reshuf_element_start, reshuf_element_amount, false);
+			}
 
-				// move elements from the northWest node to the parent node
-				for (int i = 0; i < amtElemntsNW; i++)
-				{
- 					int reshuf_element_start  = concat_this_node_maybe->parent->northWest->element_start[i];
- 					int reshuf_element_amount = concat_this_node_maybe->parent->northWest->element_amount[i];
+			// move elements from the southWest node to the parent node
+			for (int i = 0; i < amtElemntsSW; i++)
+			{
+ 				int reshuf_element_start  = t->southWest->element_start[i];
+ 				int reshuf_element_amount = t->southWest->element_amount[i];
 
-					concat_this_node_maybe->parent->element_start.push_back(reshuf_element_start);
-					concat_this_node_maybe->parent->element_amount.push_back(reshuf_element_amount);
-				}
+				push_element(t, reshuf_element_start, reshuf_element_amount, false);
+			}
 
-				// move elements from the southEast node to the parent node
-				for (int i = 0; i < amtElemntsSE; i++)
-				{
- 					int reshuf_element_start = concat_this_node_maybe->parent->southEast->element_start[i];
- 					int reshuf_element_amount = concat_this_node_maybe->parent->southEast->element_amount[i];
+			// move shared_element_start and shared_element_amount
+			std::set< std::pair<int, int> > insert_shared_elements;
+			std::set< std::pair<int, int> > insert_full_elements;
 
-					concat_this_node_maybe->parent->element_start.push_back(reshuf_element_start);
-					concat_this_node_maybe->parent->element_amount.push_back(reshuf_element_amount);
-				}
 
-				// move elements from the southWest node to the parent node
-				for (int i = 0; i < amtElemntsSW; i++)
-				{
- 					int reshuf_element_start  = concat_this_node_maybe->parent->southWest->element_start[i];
- 					int reshuf_element_amount = concat_this_node_maybe->parent->southWest->element_amount[i];
+			// shared space -> NE
+			for (int i = 0; i < (int)t->northEast->shared_element_start.size(); i++)
+			{
+ 				int reshuf_element_start1  = t->northEast->shared_element_start[i];
+ 				int reshuf_element_amount1 = t->northEast->shared_element_amount[i];
 
-					concat_this_node_maybe->parent->element_start.push_back(reshuf_element_start);
-					concat_this_node_maybe->parent->element_amount.push_back(reshuf_element_amount);
-				}
+				// determine, if the element now resides completely in the node -> insert into element_start and element_amount
+				auto returnAABB = genAABBBox(reshuf_element_start1, reshuf_element_amount1);
 
-				// move shared_element_start and shared_element_amount
-				std::set< std::pair<int, int> > insert_shared_elements;
-				std::set< std::pair<int, int> > insert_full_elements;
+				// check if all the element can be fit completely into the node -> if an previous shared element fits completely -> insert it into the "full-fit" vec, i.e., the element_start.- and element_amount.- vecs
+				bool fits = t->boundary2.contains(std::get<0>(returnAABB), std::get<1>(returnAABB), std::get<2>(returnAABB), std::get<3>(returnAABB));
 
+				int concatenate_retrieve_element = 0;
 
-				// shared space -> NE
-				for (int i = 0; i < (int)concat_this_node_maybe->parent->northEast->shared_element_start.size(); i++)
+				if (fits == true)
+				{
+					concatenate_retrieve_element = 1;
+					insert_full_elements.insert(std::make_pair(reshuf_element_start1, reshuf_element_amount1));
+				}
+				else
 				{
- 					int reshuf_element_start1  = concat_this_node_maybe->parent->northEast->shared_element_start[i];
- 					int reshuf_element_amount1 = concat_this_node_maybe->parent->northEast->shared_element_amount[i];
+					concatenate_retrieve_element = 2;
+					insert_shared_elements.insert(std::make_pair(reshuf_element_start1, reshuf_element_amount1));
+				}
 
-					// determine, if the element now resides completely in the node -> insert into element_start and element_amount
-					int count_inside = reshuf_element_amount1;
+				if (concatenate_retrieve_element == 0)
+				{
+					std::cout << "concatenate_nodes -> error retrievint element NE" << std::endl;
+					exit(1);
+				}
+			}
 
-					// check if all the element can be fit completely into the node -> if an previous shared element fits completely -> insert it into the "full-fit" vec, i.e., the element_start.- and element_amount.- vecs
-					for (int i = reshuf_element_start1; i < reshuf_element_start1+reshuf_element_amount1; i++)
-					{
-						float bdim = concat_this_node_maybe->parent->boundary2->dim;
-						float bcx  = concat_this_node_maybe->parent->boundary2->cx;
-						float bcy  = concat_this_node_maybe->parent->boundary2->cy;
-
-						if (((*ptrToX)[i] > bcx+bdim) or ((*ptrToX)[i] <= bcx-bdim) or ((*ptrToY)[i] > bcy+bdim) or ((*ptrToY)[i] <= bcy-bdim))
-						{
-							count_inside--;
-						}
-					}
 
-					int concatenate_retrieve_element = 0;
+			// shared space -> NW
+			for (int i = 0; i < (int)t->northWest->shared_element_start.size(); i++)
+			{
+ 				int reshuf_element_start1  = t->northWest->shared_element_start[i];
+ 				int reshuf_element_amount1 = t->northWest->shared_element_amount[i];
 
-					if (count_inside == reshuf_element_amount1)
-					{
-						concatenate_retrieve_element = 1;
-						insert_full_elements.insert(std::make_pair(reshuf_element_start1, reshuf_element_amount1));
-					}
-					else
-					{
-						concatenate_retrieve_element = 2;
-						insert_shared_elements.insert(std::make_pair(reshuf_element_start1, reshuf_element_amount1));
-					}
+				// determine, if the element now resides completely in the node -> insert into element_start and element_amount
+				auto returnAABB = genAABBBox(reshuf_element_start1, reshuf_element_amount1);
 
-					if (concatenate_retrieve_element == 0)
-					{
-						std::cout << "concatenate_nodes -> error retrievint element NE" << std::endl;
-						exit(1);
-					}
-				}
+				// check if all the element can be fit completely into the node -> if an previous shared element fits completely -> insert it into the "full-fit" vec, i.e., the element_start.- and element_amount.- vecs
+				bool fits = t->boundary2.contains(std::get<0>(returnAABB), std::get<1>(returnAABB), std::get<2>(returnAABB), std::get<3>(returnAABB));
 
+				int concatenate_retrieve_element = 0;
 
-				// shared space -> NW
-				for (int i = 0; i < (int)concat_this_node_maybe->parent->northWest->shared_element_start.size(); i++)
+				if (fits == true)
 				{
- 					int reshuf_element_start1  = concat_this_node_maybe->parent->northWest->shared_element_start[i];
- 					int reshuf_element_amount1 = concat_this_node_maybe->parent->northWest->shared_element_amount[i];
+					concatenate_retrieve_element = 1;
+					insert_full_elements.insert(std::make_pair(reshuf_element_start1, reshuf_element_amount1));
+				}
+				else
+				{
+					concatenate_retrieve_element = 2;
+					insert_shared_elements.insert(std::make_pair(reshuf_element_start1, reshuf_element_amount1));
+				}
 
-					// determine, if the element now resides completely in the node -> insert into element_start and element_amount
-					int count_inside = reshuf_element_amount1;
+				if (concatenate_retrieve_element == 0)
+				{
+					std::cout << "concatenate_nodes -> error retrievint element NE" << std::endl;
+					exit(1);
+				}
+			}
 
-					// check if all the element can be fit completely into the node -> if an previous shared element fits completely -> insert it into the "full-fit" vec, i.e., the element_start.- and element_amount.- vecs
-					for (int i = reshuf_element_start1; i < reshuf_element_start1+reshuf_element_amount1; i++)
-					{
-						float bdim = concat_this_node_maybe->parent->boundary2->dim;
-						float bcx  = concat_this_node_maybe->parent->boundary2->cx;
-						float bcy  = concat_this_node_maybe->parent->boundary2->cy;
-
-						if (((*ptrToX)[i] > bcx+bdim) or ((*ptrToX)[i] <= bcx-bdim) or ((*ptrToY)[i] > bcy+bdim) or ((*ptrToY)[i] <= bcy-bdim))
-						{
-							count_inside--;
-						}
-					}
 
-					int concatenate_retrieve_element = 0;
 
-					if (count_inside == reshuf_element_amount1)
-					{
-						concatenate_retrieve_element = 1;
-						insert_full_elements.insert(std::make_pair(reshuf_element_start1, reshuf_element_amount1));
-					}
-					else
-					{
-						concatenate_retrieve_element = 2;
-						insert_shared_elements.insert(std::make_pair(reshuf_element_start1, reshuf_element_amount1));
-					}
+			// shared space -> SE
+			for (int i = 0; i < (int)t->southEast->shared_element_start.size(); i++)
+			{
+ 				int reshuf_element_start1  = t->southEast->shared_element_start[i];
+ 				int reshuf_element_amount1 = t->southEast->shared_element_amount[i];
 
-					if (concatenate_retrieve_element == 0)
-					{
-						std::cout << "concatenate_nodes -> error retrievint element NE" << std::endl;
-						exit(1);
-					}
-				}
+				// determine, if the element now resides completely in the node -> insert into element_start and element_amount
+				auto returnAABB = genAABBBox(reshuf_element_start1, reshuf_element_amount1);
 
+				// check if all the element can be fit completely into the node -> if an previous shared element fits completely -> insert it into the "full-fit" vec, i.e., the element_start.- and element_amount.- vecs
+				bool fits = t->boundary2.contains(std::get<0>(returnAABB), std::get<1>(returnAABB), std::get<2>(returnAABB), std::get<3>(returnAABB));
 
+				int concatenate_retrieve_element = 0;
 
-				// shared space -> SE
-				for (int i = 0; i < (int)concat_this_node_maybe->parent->southEast->shared_element_start.size(); i++)
+				if (fits == true)
+				{
+					concatenate_retrieve_element = 1;
+					insert_full_elements.insert(std::make_pair(reshuf_element_start1, reshuf_element_amount1));
+				}
+				else
 				{
- 					int reshuf_element_start1  = concat_this_node_maybe->parent->southEast->shared_element_start[i];
- 					int reshuf_element_amount1 = concat_this_node_maybe->parent->southEast->shared_element_amount[i];
+					concatenate_retrieve_element = 2;
+					insert_shared_elements.insert(std::make_pair(reshuf_element_start1, reshuf_element_amount1));
+				}
 
-					// determine, if the element now resides completely in the node -> insert into element_start and element_amount
-					int count_inside = reshuf_element_amount1;
+				if (concatenate_retrieve_element == 0)
+				{
+					std::cout << "concatenate_nodes -> error retrievint element NE" << std::endl;
+					exit(1);
+				}
+			}
 
-					// check if all the element can be fit completely into the node -> if an previous shared element fits completely -> insert it into the "full-fit" vec, i.e., the element_start.- and element_amount.- vecs
-					for (int i = reshuf_element_start1; i < reshuf_element_start1+reshuf_element_amount1; i++)
-					{
-						float bdim = concat_this_node_maybe->parent->boundary2->dim;
-						float bcx  = concat_this_node_maybe->parent->boundary2->cx;
-						float bcy  = concat_this_node_maybe->parent->boundary2->cy;
-
-						if (((*ptrToX)[i] > bcx+bdim) or ((*ptrToX)[i] <= bcx-bdim) or ((*ptrToY)[i] > bcy+bdim) or ((*ptrToY)[i] <= bcy-bdim))
-						{
-							count_inside--;
-						}
-					}
 
-					int concatenate_retrieve_element = 0;
 
-					if (count_inside == reshuf_element_amount1)
-					{
-						concatenate_retrieve_element = 1;
-						insert_full_elements.insert(std::make_pair(reshuf_element_start1, reshuf_element_amount1));
-					}
-					else
-					{
-						concatenate_retrieve_element = 2;
-						insert_shared_elements.insert(std::make_pair(reshuf_element_start1, reshuf_element_amount1));
-					}
 
-					if (concatenate_retrieve_element == 0)
-					{
-						std::cout << "concatenate_nodes -> error retrievint element NE" << std::endl;
-						exit(1);
-					}
-				}
+			// shared space -> SW
+			for (int i = 0; i < (int)t->southWest->shared_element_start.size(); i++)
+			{
+ 				int reshuf_element_start1  = t->southWest->shared_element_start[i];
+ 				int reshuf_element_amount1 = t->southWest->shared_element_amount[i];
 
+				// determine, if the element now resides completely in the node -> insert into element_start and element_amount
+				auto returnAABB = genAABBBox(reshuf_element_start1, reshuf_element_amount1);
 
+				// check if all the element can be fit completely into the node -> if an previous shared element fits completely -> insert it into the "full-fit" vec, i.e., the element_start.- and element_amount.- vecs
+				bool fits = t->boundary2.contains(std::get<0>(returnAABB), std::get<1>(returnAABB), std::get<2>(returnAABB), std::get<3>(returnAABB));
 
+				int concatenate_retrieve_element = 0;
 
-				// shared space -> SW
-				for (int i = 0; i < (int)concat_this_node_maybe->parent->southWest->shared_element_start.size(); i++)
+				if (fits == true)
 				{
- 					int reshuf_element_start1  = concat_this_node_maybe->parent->southWest->shared_element_start[i];
- 					int reshuf_element_amount1 = concat_this_node_maybe->parent->southWest->shared_element_amount[i];
-
-					// determine, if the element now resides completely in the node -> insert into element_start and element_amount
-					int count_inside = reshuf_element_amount1;
+					concatenate_retrieve_element = 1;
+					insert_full_elements.insert(std::make_pair(reshuf_element_start1, reshuf_element_amount1));
+				}
+				else
+				{
+					concatenate_retrieve_element = 2;
+					insert_shared_elements.insert(std::make_pair(reshuf_element_start1, reshuf_element_amount1));
+				}
 
-					// check if all the element can be fit completely into the node -> if an previous shared element fits completely -> insert it into the "full-fit" vec, i.e., the element_start.- and element_amount.- vecs
-					for (int i = reshuf_element_start1; i < reshuf_element_start1+reshuf_element_amount1; i++)
-					{
-						float bdim = concat_this_node_maybe->parent->boundary2->dim;
-						float bcx  = concat_this_node_maybe->parent->boundary2->cx;
-						float bcy  = concat_this_node_maybe->parent->boundary2->cy;
-
-						if (((*ptrToX)[i] > bcx+bdim) or ((*ptrToX)[i] <= bcx-bdim) or ((*ptrToY)[i] > bcy+bdim) or ((*ptrToY)[i] <= bcy-bdim))
-						{
-							count_inside--;
-						}
-					}
+				if (concatenate_retrieve_element == 0)
+				{
+					std::cout << "concatenate_nodes -> error retrievint element NE" << std::endl;
+					exit(1);
+				}
+			}
 
-					int concatenate_retrieve_element = 0;
+			// push the retrieved elements into the full space of the parent node
+			// create an iterator for the std::pair
+			std::set< std::pair<int, int> >::iterator it1;
 
-					if (count_inside == reshuf_element_amount1)
-					{
-						concatenate_retrieve_element = 1;
-						insert_full_elements.insert(std::make_pair(reshuf_element_start1, reshuf_element_amount1));
-					}
-					else
-					{
-						concatenate_retrieve_element = 2;
-						insert_shared_elements.insert(std::make_pair(reshuf_element_start1, reshuf_element_amount1));
-					}
+			for(it1 = insert_full_elements.begin(); it1 != insert_full_elements.end(); ++it1)
+			{
+				push_element(t, it1->first, it1->second, false);
+			}
 
-					if (concatenate_retrieve_element == 0)
-					{
-						std::cout << "concatenate_nodes -> error retrievint element NE" << std::endl;
-						exit(1);
-					}
-				}
+			// push the retrieved elements into the shared space of the parent node
+			// create an iterator for the std::pair
+			std::set< std::pair<int, int> >::iterator it2;
 
-				// push the retrieved elements into the full space of the parent node
-				// create an iterator for the std::pair
-				std::set< std::pair<int, int> >::iterator it1;
+			for(it2 = insert_shared_elements.begin(); it2 != insert_shared_elements.end(); ++it2)
+			{
+				push_element(t, it2->first, it2->second, true);
+			}
 
-				for(it1 = insert_full_elements.begin(); it1 != insert_full_elements.end(); ++it1)
-				{
-					concat_this_node_maybe->parent->element_start.push_back(it1->first);
-					concat_this_node_maybe->parent->element_amount.push_back(it1->second);
-				}
+			// delete the sibling nodes (of the removed point)
+			t->clearNode();
 
-				// push the retrieved elements into the shared space of the parent node
-				// create an iterator for the std::pair
-				std::set< std::pair<int, int> >::iterator it2;
+			QUADTREE_STATS_ADD(merges, 1);
 
-				for(it2 = insert_shared_elements.begin(); it2 != insert_shared_elements.end(); ++it2)
-				{
-					concat_this_node_maybe->parent->shared_element_start.push_back(it2->first);
-					concat_this_node_maybe->parent->shared_element_amount.push_back(it2->second);
-				}
+			return true;
+		}
+	}
 
-				// generate a pointer to the next node to concatenate (prevents an invalid read)
-				Quadtree *concat_next = concat_this_node_maybe->parent;
+	return false;
+}
 
-				// delete the sibling nodes (of the removed point)
-				concat_this_node_maybe->parent->clearNode();
+// auxiliary function used by delete_element(). Used to collapse nodes and redistribute elements after collapsing.
+template <typename Scalar>
+void BasicQuadtree<Scalar>::concatenate_nodes(BasicQuadtree *concat_this_node_maybe)
+{
+	if (concat_this_node_maybe->parent == concat_this_node_maybe)   // element resides in parent -> do nothing
+	{
+	}
+	else
+	{
+		// generate a pointer to the next node to concatenate (prevents an invalid read)
+		BasicQuadtree *concat_next = concat_this_node_maybe->parent;
 
-				// proceed with the recursion
-				concatenate_nodes(concat_next);
-			}
+		// proceed with the recursion
+		if (merge_children(concat_next))
+		{
+			concatenate_nodes(concat_next);
 		}
 	}
 }
 
 
 // remove a single element from the tree
-bool Quadtree::delete_element(int iStart, int iAmount)
+template <typename Scalar>
+bool BasicQuadtree<Scalar>::delete_element(int iStart, int iAmount)
 {
+	QUADTREE_STATS_TIMER(QUADTREE_OP_DELETE);
+
+	versions->elements++;
+
 	// try to locate the node where the point lies
-	Quadtree *fetch_node = fetch_deepest_node(iStart, iAmount);
+	BasicQuadtree *fetch_node = fetch_deepest_node(iStart, iAmount);
 
 	if (fetch_node == nullptr)   // this element is not in the QT
 	{
 		std::cout << "delete_element -> cant find node corresponding to the element" << std::endl;
 		exit(1);
 	}
-	else
-	{
-		// element resides in a leafnode, i.e., a deepest node possible. This means the element fits completely into a single (leaf)node. Remove the element from element_start and element_amount and then check, whether this was the only element (if this is the case, this node may be concatenated)
 
-		// element fits completely into a single node or one element, which does not fit into a single node or it  resides in the shared space of the root node
-		if (fetch_node->northEast == nullptr)
-		{
-			// try to locate the element in the element_start vector (which means the element fits completely into the retrieved node)
-			int i = 0;
- 			int k = 0;
+	bool fullElement = remove_element(fetch_node, iStart, iAmount);
 
-			bool found_i = false;
-   			bool found_k = false;
+	forget_AABB(iStart);
 
-			for (i = 0; i < (int)fetch_node->element_start.size(); i++)
-			{
-				if (fetch_node->element_start[i] == iStart and fetch_node->element_amount[i] == iAmount)
-				{
-					found_i = true;
-					break;
-				}
-			}
+	concatenate_after_removal(fetch_node, fullElement);
 
-			// last element in the QT may reside in the shared space
-			for (k = 0; k < (int)fetch_node->shared_element_start.size(); k++)
-			{
-				if (fetch_node->shared_element_start[k] == iStart and fetch_node->shared_element_amount[k] == iAmount)
-				{
-  					found_k = true;
-					break;
-				}
-			}
+	return true;
+}
 
-			// element is in the "element_start" vector -> delete from element_start and element_amount
-			if (found_i == true)
-			{
-				fetch_node->element_start.erase(fetch_node->element_start.begin()+i);
-				fetch_node->element_amount.erase(fetch_node->element_amount.begin()+i);
+template <typename Scalar>
+bool BasicQuadtree<Scalar>::remove_element(BasicQuadtree *fetch_node, int iStart, int iAmount)
+{
+	// reverse index available -> no need to search the element in the leaf nodes
+	if (elementIndex != nullptr)
+	{
+		return remove_element_indexed(iStart, iAmount);
+	}
 
-				if ((int)fetch_node->element_start.size() != (int)fetch_node->element_amount.size())
-				{
-					std::cout << "mismatch" << std::endl;
-					exit(1);
-				}
+	// element resides in a leafnode, i.e., a deepest node possible. This means the element fits completely into a single (leaf)node. Remove the element from element_start and element_amount.
 
-				// this was the only element in the node -> concatenate
-				if ((int)fetch_node->element_start.size() == 0)
-				{
-// 					std::cout << "CONTAT" << std::endl;
- 					concatenate_nodes(fetch_node);
-				}
-			}
-			// e.g. we remove the last element and this element is in the shared space of the root node (and the root node is the only node there is)
+	// element fits completely into a single node or one element, which does not fit into a single node or it  resides in the shared space of the root node (or every element resides in a single node, see set_storage())
+	if ((fetch_node->northEast == nullptr) or single_node_storage())
+	{
+		// try to locate the element in the element_start vector (which means the element fits completely into the retrieved node)
+		int i = 0;
+		int k = 0;
+
+		bool found_i = false;
+		bool found_k = false;
 
-			else if (found_k == true)
+		for (i = 0; i < (int)fetch_node->element_start.size(); i++)
+		{
+			if (fetch_node->element_start[i] == iStart and fetch_node->element_amount[i] == iAmount)
 			{
-				fetch_node->shared_element_start.erase(fetch_node->shared_element_start.begin()+k);
-				fetch_node->shared_element_amount.erase(fetch_node->shared_element_amount.begin()+k);
+				found_i = true;
+				break;
 			}
-			// element was neither in the shared nor in the regular vector
-			else
+		}
+
+		// last element in the QT may reside in the shared space
+		for (k = 0; k < (int)fetch_node->shared_element_start.size(); k++)
+		{
+			if (fetch_node->shared_element_start[k] == iStart and fetch_node->shared_element_amount[k] == iAmount)
 			{
-				std::cout << "delete_element() -> element was found neither in the complete nor in the shared space" << std::endl;
- 				exit(1);
+				found_k = true;
+				break;
 			}
-
-			return true;
-			// TODO -> check if everything worked properly ?!
 		}
-		// element resides in multiple nodes because it does not fit completely into a single node. Erase the given element from shared_element_start and shared_element_amount recursively
-		else
-		{
-			// generate the AABB boundary box
-			auto returnAABB = genAABBBox(iStart, iAmount);
-			float xmin = std::get<0>(returnAABB);
-			float xmax = std::get<1>(returnAABB);
-			float ymin = std::get<2>(returnAABB);
-			float ymax = std::get<3>(returnAABB);
-
-			// remove the element from all subnodes it resides
-			recursive_removeAABB(fetch_node, xmin, xmax, ymin, ymax, iStart, iAmount);
 
-			// catch cases, where a node has been split, but all elements reside in the shared space of the four subnodes
+		// element is in the "element_start" vector -> delete from element_start and element_amount
+		if (found_i == true)
+		{
+			erase_element(fetch_node, i, false);
 
-			// Check whether the node, from which the element was removed, has only four subnodes. If there are only elements in the shared-vectors this may result in the node not being concatenated.
-			if ((fetch_node->northEast->northEast == nullptr) && (fetch_node->northWest->northEast == nullptr) && (fetch_node->southEast->northEast == nullptr) && (fetch_node->southWest->northEast == nullptr))
+			if ((int)fetch_node->element_start.size() != (int)fetch_node->element_amount.size())
 			{
-				int amt_el_start_NE = fetch_node->northEast->element_start.size();
-				int amt_el_start_NW = fetch_node->northWest->element_start.size();
-				int amt_el_start_SE = fetch_node->southEast->element_start.size();
-				int amt_el_start_SW = fetch_node->southWest->element_start.size();
-
-				// concatenate 
-				if ((amt_el_start_NE == 0) and (amt_el_start_NW == 0) and (amt_el_start_SE == 0) and (amt_el_start_SW == 0))
-				{
-					concatenate_nodes(fetch_node->northEast);
-				}
+				std::cout << "mismatch" << std::endl;
+				exit(1);
 			}
+
 			return true;
 		}
+		// e.g. we remove the last element and this element is in the shared space of the root node (and the root node is the only node there is)
+		else if (found_k == true)
+		{
+			erase_element(fetch_node, k, true);
+		}
+		// element was neither in the shared nor in the regular vector
+		else
+		{
+			std::cout << "delete_element() -> element was found neither in the complete nor in the shared space" << std::endl;
+			exit(1);
+		}
+	}
+	// element resides in multiple nodes because it does not fit completely into a single node. Erase the given element from shared_element_start and shared_element_amount recursively
+	else
+	{
+		// generate the AABB boundary box
+		auto returnAABB = genAABBBox(iStart, iAmount);
+		Scalar xmin = std::get<0>(returnAABB);
+		Scalar xmax = std::get<1>(returnAABB);
+		Scalar ymin = std::get<2>(returnAABB);
+		Scalar ymax = std::get<3>(returnAABB);
+
+		// remove the element from all subnodes it resides
+		recursive_removeAABB(fetch_node, xmin, xmax, ymin, ymax, iStart, iAmount);
 	}
+
 	return false;
 }
 
-
-bool Quadtree::relocate_element(int iStartPreMovement, int iAmountPreMovement, const std::vector<float>* relocateNewCoordinatesx, const std::vector<float>* relocateNewCoordinatesy)
+template <typename Scalar>
+bool BasicQuadtree<Scalar>::remove_element_indexed(int iStart, int iAmount)
 {
-	// locate the node (pre movement)
-	Quadtree *fetchNodePre = fetch_deepest_node(iStartPreMovement, iAmountPreMovement);
+	auto it = elementIndex->find(iStart);
 
-	// try to locate the node where the element lies (post movement)
-	Quadtree *ReturnNode = this;
+	if (it == elementIndex->end())
+	{
+		std::cout << "delete_element() -> element was found neither in the complete nor in the shared space" << std::endl;
+		exit(1);
+	}
 
- 	Quadtree *fetchNodePost = fetch_deepest_node_internal(ReturnNode, 0, (*relocateNewCoordinatesx).size(), relocateNewCoordinatesx, relocateNewCoordinatesy);
+	// copy the slots (erase_element modifies the reverse index)
+	std::vector<ElementSlot> slots = it->second;
+	bool fullElement = false;
 
-	// object stays in the same node if both (post/pre-nodes) are equal. Additionally this node should be the deepest one possible.
-	if (fetchNodePost == fetchNodePre and fetchNodePost->northEast == nullptr)
+	for (int i = 0; i < (int)slots.size(); i++)
 	{
+		std::vector<int> &vecAmount = slots[i].shared ? slots[i].node->shared_element_amount : slots[i].node->element_amount;
 
-		// just update the coordinates
-		for (int i = iStartPreMovement; i < iStartPreMovement + iAmountPreMovement; i++)
+		if (vecAmount[slots[i].slot] != iAmount)
 		{
-			(*ptrToX)[i] = (*relocateNewCoordinatesx)[i - iStartPreMovement];
-			(*ptrToY)[i] = (*relocateNewCoordinatesy)[i - iStartPreMovement];
+			std::cout << "delete_element() -> element was found neither in the complete nor in the shared space" << std::endl;
+			exit(1);
 		}
 
-		return true;
+		if (slots[i].shared == false)
+		{
+			fullElement = true;
+		}
+
+		erase_element(slots[i].node, slots[i].slot, slots[i].shared);
 	}
-	else
+
+	return fullElement;
+}
+
+template <typename Scalar>
+void BasicQuadtree<Scalar>::concatenate_after_removal(BasicQuadtree *fetch_node, bool fullElement)
+{
+	// deferred merging -> the nodes are concatenated by collect_garbage()
+	if (mergeSettings->deferred)
 	{
-		// delete element -> it has crossed 'node-borders'
-		delete_element(iStartPreMovement, iAmountPreMovement);
+		defer_merge(fetch_node);
+		return;
+	}
 
-		for (int i = iStartPreMovement; i < iStartPreMovement + iAmountPreMovement; i++)
+	// element resided in a leafnode -> concatenate if the leaf node (and its siblings) may hold less elements than the merge threshold
+	if (fetch_node->northEast == nullptr)
+	{
+		if ((fullElement == true) and (fetch_node->element_start.size() < mergeSettings->threshold))
 		{
-			(*ptrToX)[i] = (*relocateNewCoordinatesx)[i - iStartPreMovement];
-			(*ptrToY)[i] = (*relocateNewCoordinatesy)[i - iStartPreMovement];
+			concatenate_nodes(fetch_node);
 		}
+	}
+	// element resided in the shared space of the subnodes. Check whether the node, from which the element was removed, has only four subnodes. If there are only elements in the shared-vectors this may result in the node not being concatenated.
+	else if ((fetch_node->northEast->northEast == nullptr) && (fetch_node->northWest->northEast == nullptr) && (fetch_node->southEast->northEast == nullptr) && (fetch_node->southWest->northEast == nullptr))
+	{
+		// concatenate_nodes() checks the amount of elements of the four subnodes
+		concatenate_nodes(fetch_node->northEast);
+	}
+}
 
-		// reinsert it (TODO: DONT reinsert from the root node -> try to insert into parent node)
-		bool tryInsert = insert(iStartPreMovement, iAmountPreMovement);
+// mark the node and its parent nodes (up to the first node which has already been marked)
+template <typename Scalar>
+void BasicQuadtree<Scalar>::defer_merge(BasicQuadtree *t)
+{
+	while (t->mergePending == false)
+	{
+		t->mergePending = true;
 
-		// element moved out of the qt
-		if (tryInsert == false)
-		{
-			return false;
-		}
-		else
+		if (t == t->parent)
 		{
-			return true;
+			break;
 		}
+
+		t = t->parent;
 	}
+}
 
-	return false;
+template <typename Scalar>
+bool BasicQuadtree<Scalar>::set_merge_threshold(unsigned int threshold)
+{
+	if ((this != this->parent) or (threshold > maxAmtElements))
+	{
+		return false;
+	}
+
+	mergeSettings->threshold = threshold;
+
+	return true;
 }
 
+template <typename Scalar>
+bool BasicQuadtree<Scalar>::set_deferred_merging(bool deferred)
+{
+	if (this != this->parent)
+	{
+		return false;
+	}
+
+	// perform the merges which are still pending
+	if ((mergeSettings->deferred == true) and (deferred == false))
+	{
+		collect_garbage();
+	}
+
+	mergeSettings->deferred = deferred;
+
+	return true;
+}
 
-// visualizes the nodes, which can be concatenated (colored) and the nodes which only inherits elements in the shared space (shared_element_start, shared_element_amount). The latter are colored grey.
-void Quadtree::find_concatenable_shared_nodes(Quadtree *t)
+// perform all pending merges (the children of a node are merged after its marked subtrees have been compacted, i.e., a whole subtree may collapse within a single pass)
+template <typename Scalar>
+int BasicQuadtree<Scalar>::collect_garbage()
 {
-	// deepest node of the QT reached
-	if ((t->northEast == nullptr) && (t->parent != t))
+	if (this != this->parent)
 	{
- 		if ((t->parent->northWest->northWest == nullptr) and (t->parent->southEast->northWest == nullptr) and (t->parent->southWest->northWest == nullptr) and (t->parent->northEast->northWest == nullptr))
-		{
-			// draw
-			int s1 = t->parent->northWest->element_start.size();
-			int s2 = t->parent->northEast->element_start.size();
-			int s3 = t->parent->southWest->element_start.size();
-			int s4 = t->parent->southEast->element_start.size();
+		std::cout << "collect_garbage -> has to be called on the root node" << std::endl;
+		return 0;
+	}
 
-			bool color_overwrite = false;
+	if (mergePending == false)
+	{
+		return 0;
+	}
 
-			if ((s1 == 0) and (s2 == 0) and (s3 == 0) and (s4 == 0))
-			{
-				color_overwrite = true;
-			}
+	return collect_garbage_internal(this);
+}
 
-			// DRAW
-			float elevate = -10.0;
+template <typename Scalar>
+int BasicQuadtree<Scalar>::collect_garbage_internal(BasicQuadtree *t)
+{
+	t->mergePending = false;
 
-			float centerx = t->parent->northWest->boundary2->cx;
-			float centery = t->parent->northWest->boundary2->cy;
-			float dim = t->parent->northWest->boundary2->dim;
+	// leaf node -> nothing to merge
+	if (t->northWest == nullptr)
+	{
+		return 0;
+	}
 
-			if (color_overwrite == false)
-				glColor4f(1.0f, 0.0f, 0.0f, 0.15f);
-			else
-			{
-				glColor4f(0.0f, 0.0f, 0.0f, 0.25f);
-			}
+	int merges = 0;
 
-			glBegin(GL_TRIANGLE_STRIP);
-				glVertex3f(centerx+dim, centery+dim, elevate);
-				glVertex3f(centerx+dim, centery-dim, elevate);
-				glVertex3f(centerx-dim, centery+dim, elevate);
-				glVertex3f(centerx-dim, centery-dim, elevate);
-			glEnd();
+	if (t->northEast->mergePending)
+	{
+		merges += collect_garbage_internal(t->northEast);
+	}
 
-			centerx = t->parent->northEast->boundary2->cx;
-			centery = t->parent->northEast->boundary2->cy;
-			dim = t->parent->northEast->boundary2->dim;
+	if (t->northWest->mergePending)
+	{
+		merges += collect_garbage_internal(t->northWest);
+	}
 
-			if (color_overwrite == false)
-				glColor4f(0.0f, 1.0f, 0.0f, 0.15f);
-			else
-			{
-				glColor4f(0.0f, 0.0f, 0.0f, 0.25f);
-			}
+	if (t->southEast->mergePending)
+	{
+		merges += collect_garbage_internal(t->southEast);
+	}
 
-			glBegin(GL_TRIANGLE_STRIP);
-				glVertex3f(centerx+dim, centery+dim, elevate);
-				glVertex3f(centerx+dim, centery-dim, elevate);
-				glVertex3f(centerx-dim, centery+dim, elevate);
-				glVertex3f(centerx-dim, centery-dim, elevate);
-			glEnd();
+	if (t->southWest->mergePending)
+	{
+		merges += collect_garbage_internal(t->southWest);
+	}
 
-			centerx = t->parent->southWest->boundary2->cx;
-			centery = t->parent->southWest->boundary2->cy;
-			dim = t->parent->southWest->boundary2->dim;
+	if (merge_children(t))
+	{
+		merges++;
+	}
 
-			if (color_overwrite == false)
-				glColor4f(0.0f, 0.0f, 1.0f, 0.15f);
-			else
-			{
-				glColor4f(0.0f, 0.0f, 0.0f, 0.25f);
-			}
+	return merges;
+}
 
-			glBegin(GL_TRIANGLE_STRIP);
-				glVertex3f(centerx+dim, centery+dim, elevate);
-				glVertex3f(centerx+dim, centery-dim, elevate);
-				glVertex3f(centerx-dim, centery+dim, elevate);
-				glVertex3f(centerx-dim, centery-dim, elevate);
-			glEnd();
 
-			centerx = t->parent->southEast->boundary2->cx;
-			centery = t->parent->southEast->boundary2->cy;
-			dim = t->parent->southEast->boundary2->dim;
+template <typename Scalar>
+bool BasicQuadtree<Scalar>::relocate_element(int iStartPreMovement, int iAmountPreMovement, const std::vector<Scalar>* relocateNewCoordinatesx, const std::vector<Scalar>* relocateNewCoordinatesy)
+{
+	QUADTREE_STATS_TIMER(QUADTREE_OP_RELOCATE);
 
-			if (color_overwrite == false)
-				glColor4f(1.0f, 0.0f, 1.0f, 0.15f);
-			else
+	versions->elements++;
+
+	// locate the node (pre movement)
+	BasicQuadtree *fetchNodePre = fetch_deepest_node(iStartPreMovement, iAmountPreMovement);
+
+	// AABB boundary box of the element (post movement)
+	Scalar xmin, xmax, ymin, ymax;
+	points_AABB(relocateNewCoordinatesx->data(), relocateNewCoordinatesy->data(), iAmountPreMovement, xmin, xmax, ymin, ymax);
+
+	// every element resides in a single node: walk up from the node pre movement to the smallest node enclosing the element (post movement) and descend from there
+	if (single_node_storage())
+	{
+		// the element leaves the root node -> it is removed (same as insert())
+		if ((boundary2.contains(xmin, xmax, ymin, ymax) == false) and (count_points_inside(relocateNewCoordinatesx->data(), relocateNewCoordinatesy->data(), iAmountPreMovement, boundary2.cx-boundary2.dim, boundary2.cx+boundary2.dim, boundary2.cy-boundary2.dim, boundary2.cy+boundary2.dim) == 0))
+		{
+			remove_element(fetchNodePre, iStartPreMovement, iAmountPreMovement);
+
+			for (int i = iStartPreMovement; i < iStartPreMovement + iAmountPreMovement; i++)
 			{
-				glColor4f(0.0f, 0.0f, 0.0f, 0.25f);
+				(*ptrToX)[i] = (*relocateNewCoordinatesx)[i - iStartPreMovement];
+				(*ptrToY)[i] = (*relocateNewCoordinatesy)[i - iStartPreMovement];
 			}
 
-			glBegin(GL_TRIANGLE_STRIP);
-				glVertex3f(centerx+dim, centery+dim, elevate);
-				glVertex3f(centerx+dim, centery-dim, elevate);
-				glVertex3f(centerx-dim, centery+dim, elevate);
-				glVertex3f(centerx-dim, centery-dim, elevate);
-			glEnd();
+			forget_AABB(iStartPreMovement);
+			concatenate_after_removal(fetchNodePre, true);
+
+			return false;
 		}
 
-		return;
+		// center of the AABB boundary box (doubled, see fetch_enclosing_node())
+		Real centerx = (Real)xmin + (Real)xmax;
+		Real centery = (Real)ymin + (Real)ymax;
+
+		// fetch_enclosing_node() follows the children nodes containing the center, i.e., the ancestor has to contain the center as well (loose bounds: the enlarged bounds of a node not containing the center may still enclose the element)
+		auto encloses = [this, xmin, xmax, ymin, ymax, centerx, centery](const BasicQuadtree *t)
+		{
+			return t->boundary2.contains_loose(xmin, xmax, ymin, ymax, loose_dim(t)) and (centerx > 2*((Real)t->boundary2.cx-(Real)t->boundary2.dim)) and (centerx <= 2*((Real)t->boundary2.cx+(Real)t->boundary2.dim)) and (centery > 2*((Real)t->boundary2.cy-(Real)t->boundary2.dim)) and (centery <= 2*((Real)t->boundary2.cy+(Real)t->boundary2.dim));
+		};
+
+		BasicQuadtree *ancestor = fetchNodePre;
+
+		while ((ancestor != ancestor->parent) and (encloses(ancestor) == false))
+		{
+			ancestor = ancestor->parent;
+		}
+
+		BasicQuadtree *fetchNodePost = fetch_enclosing_node(ancestor, xmin, xmax, ymin, ymax);
+
+		if (fetchNodePost != fetchNodePre)
+		{
+			remove_element(fetchNodePre, iStartPreMovement, iAmountPreMovement);
+		}
+
+		for (int i = iStartPreMovement; i < iStartPreMovement + iAmountPreMovement; i++)
+		{
+			(*ptrToX)[i] = (*relocateNewCoordinatesx)[i - iStartPreMovement];
+			(*ptrToY)[i] = (*relocateNewCoordinatesy)[i - iStartPreMovement];
+		}
+
+		refresh_AABB(iStartPreMovement, iAmountPreMovement);
+
+		// the element stays in its node
+		if (fetchNodePost == fetchNodePre)
+		{
+			return true;
+		}
+
+		// insert into the node post movement (split if full), the nodes are concatenated after the reinsertion
+		insert_enclosing(fetchNodePost, xmin, xmax, ymin, ymax, iStartPreMovement, iAmountPreMovement);
+
+		concatenate_after_removal(fetchNodePre, true);
+
+		return true;
 	}
-	else
+
+	auto fits_into = [xmin, xmax, ymin, ymax](const BasicQuadtree *t)
+	{
+		return t->boundary2.contains(xmin, xmax, ymin, ymax);
+	};
+
+	// walk up from the node pre movement to the smallest node in which the element (post movement) fits completely
+	BasicQuadtree *ancestor = fetchNodePre;
+
+	while ((ancestor != nullptr) and (fits_into(ancestor) == false) and (ancestor != ancestor->parent))
+	{
+		ancestor = ancestor->parent;
+	}
+
+	// the element leaves the root node (or is not in the tree) -> delete element and reinsert it from the root node
+	if ((ancestor == nullptr) or (fits_into(ancestor) == false))
 	{
-		// anything NOT in the deepest node should evoke an error
-		if (t->parent != t)
+		delete_element(iStartPreMovement, iAmountPreMovement);
+
+		for (int i = iStartPreMovement; i < iStartPreMovement + iAmountPreMovement; i++)
 		{
-			if (t->shared_element_start.size() > 0 or t->shared_element_amount.size() > 0 or t->element_start.size() > 0 or t->element_amount.size() > 0)
-			{
-				std::cout << "elements not in deepest node" << std::endl;
-	 			exit(1);
-			}
+			(*ptrToX)[i] = (*relocateNewCoordinatesx)[i - iStartPreMovement];
+			(*ptrToY)[i] = (*relocateNewCoordinatesy)[i - iStartPreMovement];
+		}
+
+		// element moved out of the qt
+		return insert(iStartPreMovement, iAmountPreMovement);
+	}
+
+	// Object stays in the same node if the node pre movement is a leaf node which contains the element completely (pre and post movement) -> just update the coordinates
+	bool stays = (ancestor == fetchNodePre) and (fetchNodePre->northEast == nullptr);
+
+	// the root node may hold the element (pre movement) in its shared space
+	if (stays and (fetchNodePre == fetchNodePre->parent))
+	{
+		auto returnAABB = genAABBBox(iStartPreMovement, iAmountPreMovement);
+
+		stays = boundary2.contains(std::get<0>(returnAABB), std::get<1>(returnAABB), std::get<2>(returnAABB), std::get<3>(returnAABB));
+	}
+
+	if (stays == false)
+	{
+		// remove the element from the subtree of the node pre movement (the nodes are concatenated after the reinsertion, i.e., a node is not merged and split again if the element stays close)
+		bool fullElement = remove_element(fetchNodePre, iStartPreMovement, iAmountPreMovement);
+
+		for (int i = iStartPreMovement; i < iStartPreMovement + iAmountPreMovement; i++)
+		{
+			(*ptrToX)[i] = (*relocateNewCoordinatesx)[i - iStartPreMovement];
+			(*ptrToY)[i] = (*relocateNewCoordinatesy)[i - iStartPreMovement];
 		}
 
-		if (t->northEast != nullptr)
-			find_concatenable_shared_nodes(t->northEast);
+		refresh_AABB(iStartPreMovement, iAmountPreMovement);
 
-		if (t->northWest != nullptr)
-			find_concatenable_shared_nodes(t->northWest);
+		// reinsert into the subtree of the smallest node containing the element
+		ancestor->insert(iStartPreMovement, iAmountPreMovement);
 
-		if (t->southEast != nullptr)
-			find_concatenable_shared_nodes(t->southEast);
+		concatenate_after_removal(fetchNodePre, fullElement);
 
-		if (t->southWest != nullptr)
-			find_concatenable_shared_nodes(t->southWest);
+		return true;
+	}
+
+	// just update the coordinates
+	for (int i = iStartPreMovement; i < iStartPreMovement + iAmountPreMovement; i++)
+	{
+		(*ptrToX)[i] = (*relocateNewCoordinatesx)[i - iStartPreMovement];
+		(*ptrToY)[i] = (*relocateNewCoordinatesy)[i - iStartPreMovement];
 	}
+
+	refresh_AABB(iStartPreMovement, iAmountPreMovement);
+
+	return true;
+}
+
+
+// snapshot of the operation counters and latency histograms
+template <typename Scalar>
+QuadtreeStats BasicQuadtree<Scalar>::stats() const
+{
+#ifdef QUADTREE_STATS
+	return statsCounters->snapshot();
+#else
+	return QuadtreeStats();
+#endif
+}
+
+// reset the operation counters and latency histograms
+template <typename Scalar>
+void BasicQuadtree<Scalar>::reset_stats()
+{
+	QUADTREE_STATS_ONLY(statsCounters->reset());
 }
 
+
 // prints the tree (amount of elements in the vectors and the pointers to the nodes)
-void Quadtree::print_tree()
+template <typename Scalar>
+void BasicQuadtree<Scalar>::print_tree()
 {
 	std::cout << "print tree(ROOT): " << this << " | FULL: " << element_start.size()  << " / " << element_amount.size() << " ||| SHARED: " << shared_element_start.size() << " / " << shared_element_amount.size() << std::endl;
 
@@ -1237,3 +3406,9 @@ void Quadtree::print_tree()
 		southEast->print_tree();
 	}
 }
+
+
+// coordinate types of the trees (see quadtree.h)
+template class BasicQuadtree<float>;
+template class BasicQuadtree<double>;
+template class BasicQuadtree<int32_t>;
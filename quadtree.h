@@ -3,40 +3,280 @@
 #define __QUADREE_H_INCLUDED__
 
 #include <vector>
-
+#include <set>
+#include <tuple>
+#include <unordered_map>
+#include <mutex>
+#include <atomic>
+#include <string>
+
+#include <cstddef>  // std::size_t
+#include <cstdint>  // uint64_t
 #include <memory>   // std::shared_ptr
 #include <utility>  // std::unique_ptr
+#include <type_traits>
+
+#include "quadtree_stats.h"
+
+class QuadtreeSnapshot;
+
+// Split threshold and maximum depth of the trees. Defining QUADTREE_MAX_ELEMENTS and QUADTREE_MAX_DEPTH at compile time fixes both for all trees (constexpr, the arguments of the constructor are ignored). The definitions change the layout of the nodes, i.e., they have to be the same for the library and all of its users: set the CMake cache variables of the same name (e.g., -DQUADTREE_MAX_ELEMENTS=16 -DQUADTREE_MAX_DEPTH=10), which are propagated to every target linking the library. Otherwise they are set per tree by the constructor (defaults below).
+#if defined(QUADTREE_MAX_ELEMENTS) and defined(QUADTREE_MAX_DEPTH)
+	#define QUADTREE_FIXED_CONFIG
+#elif defined(QUADTREE_MAX_ELEMENTS) or defined(QUADTREE_MAX_DEPTH)
+	#error "QUADTREE_MAX_ELEMENTS and QUADTREE_MAX_DEPTH have to be defined together"
+#else
+	#define QUADTREE_MAX_ELEMENTS 1
+	#define QUADTREE_MAX_DEPTH 5
+#endif
 
-struct BoundaryBox
+// Boundary box of a node, i.e., the area (cx-dim, cx+dim] x (cy-dim, cy+dim]. Scalar: type of the coordinates (see BasicQuadtree).
+template <typename Scalar>
+struct BasicBoundaryBox
 {
-	float cx;	// center of the node (x-coordinate)
-	float cy;	// center of the node (y-coordinate)
-	float dim;	// width of the node
+	Scalar cx;	// center of the node (x-coordinate)
+	Scalar cy;	// center of the node (y-coordinate)
+	Scalar dim;	// width of the node
 
 	// constructor
-	BoundaryBox(float _cx, float _cy, float _dim)
+	BasicBoundaryBox(Scalar _cx, Scalar _cy, Scalar _dim)
 	{
 		cx  = _cx;
 		cy  = _cy;
 		dim = _dim;
 	}
+
+	// the AABB boundary box [xmin, xmax] x [ymin, ymax] of an element fits completely into the node
+	bool contains(Scalar xmin, Scalar xmax, Scalar ymin, Scalar ymax) const
+	{
+		return (xmin > cx-dim) and (xmax <= cx+dim) and (ymin > cy-dim) and (ymax <= cy+dim);
+	}
+
+	// the AABB boundary box overlaps the interior of the node. A box of zero width (or height) overlaps the node if it lies in (cx-dim, cx+dim] (as for contains()), i.e., an element fitting into a node always overlaps one of its children nodes (e.g., a horizontal segment on the center line of the node).
+	bool overlaps(Scalar xmin, Scalar xmax, Scalar ymin, Scalar ymax) const
+	{
+		return overlaps_interval(xmin, xmax, cx-dim, cx+dim) and overlaps_interval(ymin, ymax, cy-dim, cy+dim);
+	}
+
+	// the interval [vmin, vmax] overlaps the interval (lower, upper) (zero width: (lower, upper])
+	template <typename T>
+	static bool overlaps_interval(Scalar vmin, Scalar vmax, T lower, T upper)
+	{
+		return (vmax > lower) and ((vmin < upper) or ((vmin == vmax) and (vmin == upper)));
+	}
+
+	// same as contains() and overlaps() for the node enlarged to the width looseDim around its center (loose bounds, see BasicQuadtree::set_storage). Real: type of looseDim (see BasicQuadtree::Real), looseDim == dim -> identical to contains() and overlaps().
+	template <typename Real>
+	bool contains_loose(Scalar xmin, Scalar xmax, Scalar ymin, Scalar ymax, Real looseDim) const
+	{
+		return (xmin > cx-looseDim) and (xmax <= cx+looseDim) and (ymin > cy-looseDim) and (ymax <= cy+looseDim);
+	}
+
+	template <typename Real>
+	bool overlaps_loose(Scalar xmin, Scalar xmax, Scalar ymin, Scalar ymax, Real looseDim) const
+	{
+		return overlaps_interval(xmin, xmax, cx-looseDim, cx+looseDim) and overlaps_interval(ymin, ymax, cy-looseDim, cy+looseDim);
+	}
+
+	// Children node (0: NW, 1: NE, 2: SW, 3: SE) into which an AABB boundary box fitting into the node fits completely, -1 if the box straddles the center. Only exact if the boundaries of the children are exact (integer coordinates, see BasicQuadtree).
+	int quadrant(Scalar xmin, Scalar xmax, Scalar ymin, Scalar ymax) const
+	{
+		int east  = (xmin > cx);
+		int west  = (xmax <= cx);
+		int north = (ymin > cy);
+		int south = (ymax <= cy);
+
+		return ((east | west) & (north | south)) ? (east + 2*south) : -1;
+	}
+};
+
+typedef BasicBoundaryBox<float> BoundaryBox;
+
+// candidate pair of elements (see Quadtree::collect_candidate_pairs)
+struct ElementPair
+{
+	int startA;
+	int amountA;
+	int startB;
+	int amountB;
+};
+
+// element found by Quadtree::fetch_nearest_elements (distance: euclidean distance from the query point to the closest point of the element)
+template <typename Real>
+struct BasicNearestElement
+{
+	int iStart;
+	int iAmount;
+	Real distance;
+};
+
+typedef BasicNearestElement<float> NearestElement;
+
+// element hit by a ray (see Quadtree::raycast, distance: distance from the origin of the ray to the first intersection with the element)
+template <typename Real>
+struct BasicRayHit
+{
+	int iStart;
+	int iAmount;
+	Real distance;
+};
+
+typedef BasicRayHit<float> RayHit;
+
+// storage of the elements which straddle the border of a node (see BasicQuadtree::set_storage)
+enum QuadtreeStorage
+{
+	QUADTREE_STORAGE_SHARED,		// copied into the shared space of all leaf nodes they overlap (default)
+	QUADTREE_STORAGE_ENCLOSING,		// stored once, in the smallest node enclosing them
+	QUADTREE_STORAGE_LOOSE			// stored once, in the deepest node whose enlarged bounds enclose them
 };
 
-class Quadtree
+// Pool handing out the memory for the four children nodes of a node as a single contiguous block. Blocks are carved out of larger chunks and released blocks are recycled through a free list.
+class QuadtreeNodePool
 {
 	private:
-		// Children nodes
-		Quadtree *northWest;
-		Quadtree *northEast;
-		Quadtree *southWest;
-		Quadtree *southEast;
+		// size of a single block (memory of four nodes) in bytes
+		std::size_t blockSize;
+
+		// amount of blocks allocated at once
+		std::size_t blocksPerChunk;
+
+		// memory chunks of the pool and the amount of blocks handed out from the last chunk
+		std::vector< std::unique_ptr<char[]> > chunks;
+		std::size_t usedBlocksLastChunk;
+
+		// singly linked list of the released blocks (the pointer to the next block is stored inside the released block)
+		void *freeList;
+
+		// the children nodes may be allocated by several threads (parallel build)
+		std::mutex mutex;
+
+	public:
+		// constructor
+		QuadtreeNodePool(std::size_t _blockSize, std::size_t _blocksPerChunk);
+
+		// fetch the memory for a block (reuses released blocks first)
+		void *allocate_block();
+
+		// return a block to the pool
+		void release_block(void *block);
+};
+
+// Quadtree of the elements defined by the points (x[i], y[i]) stored in two std::vectors. Scalar: type of the coordinates (float, double or int32_t, see the typedefs below). Integer coordinates are exact (fixed-point, e.g. grid-snapped maps): the width dim of the root node has to be divisible by 2^maxDepth and the root node has to lie inside the range of the type.
+template <typename Scalar>
+class BasicQuadtree
+{
+	public:
+		// type of the geometric computations of the queries (distances, rays): the coordinate type, double for integer coordinates
+		typedef typename std::conditional<std::is_floating_point<Scalar>::value, Scalar, double>::type Real;
+
+		typedef BasicBoundaryBox<Scalar> Box;
+		typedef BasicNearestElement<Real> Nearest;
+		typedef BasicRayHit<Real> Hit;
+
+	private:
+		// Children nodes. The four children nodes reside in a single contiguous block starting at northWest (order: NW, NE, SW, SE)
+		BasicQuadtree *northWest;
+		BasicQuadtree *northEast;
+		BasicQuadtree *southWest;
+		BasicQuadtree *southEast;
 
 		// dimensions of the node
-		std::shared_ptr<BoundaryBox> boundary2;
+		Box boundary2;
+
+		// pool for the children nodes (nullptr -> the blocks are allocated from the heap). Owned by the root node (ownedNodePool).
+		QuadtreeNodePool *nodePool;
+		std::unique_ptr<QuadtreeNodePool> ownedNodePool;
+
+		// slot of an element in a node (position in element_start or shared_element_start)
+		struct ElementSlot
+		{
+			BasicQuadtree *node;
+			int slot;
+			bool shared;
+		};
+
+		// reverse index: element (key: iStart) -> all slots holding this element (nullptr -> no index). Owned by the root node (ownedElementIndex).
+		typedef std::unordered_map< int, std::vector<ElementSlot> > ElementIndex;
+		ElementIndex *elementIndex;
+		std::unique_ptr<ElementIndex> ownedElementIndex;
+
+		// Per-query stamps of the elements (indexed by iStart). An element has already been reported by the current query if stamp[iStart] == epoch.
+		struct QueryScratch
+		{
+			std::vector<unsigned int> stamp;
+			unsigned int epoch = 0;
+
+			// nodes still to be searched by fetch_nearest_elements() (heap, key: squared distance to the node)
+			std::vector< std::pair<Real, const BasicQuadtree *> > nodeQueue;
+
+#ifdef QUADTREE_STATS
+			// nodes visited by the queries since the last flush into the counters of the tree
+			uint64_t nodeVisits = 0;
+#endif
+		};
+
+		// scratch of the queries of the calling thread and of the worker threads of fetch_elements_batch() (only used by the root node)
+		QueryScratch queryScratch;
+		std::vector<QueryScratch> batchScratch;
+
+		// worker threads of fetch_elements_batch() (started by the first call using more than one thread, kept waiting for the next call and joined by the destructor)
+		struct BatchWorkers;
+		std::unique_ptr<BatchWorkers> batchWorkers;
+
+		// AABB boundary boxes of the elements (structure of arrays indexed by iStart). An entry is valid if amount[iStart] == iAmount of the element. Owned by the root node (ownedAABBCache).
+		struct AABBCache
+		{
+			std::vector<Scalar> xmin, xmax, ymin, ymax;
+			std::vector<int> amount;
+		};
+
+		AABBCache *aabbCache;
+		std::unique_ptr<AABBCache> ownedAABBCache;
+
+		// modification counters of the tree (see structure_version() and element_version()). Owned by the root node (ownedVersions).
+		struct Versions
+		{
+			std::atomic<uint64_t> structure{0};	// nodes are split by several threads during a parallel build
+			uint64_t elements = 0;
+		};
+
+		Versions *versions;
+		std::unique_ptr<Versions> ownedVersions;
+
+		// merging of the children nodes (see set_merge_threshold() and set_deferred_merging()). Owned by the root node (ownedMergeSettings).
+		struct MergeSettings
+		{
+			unsigned int threshold;		// four leaf nodes are merged if they hold less elements than the threshold
+			bool deferred = false;		// merges are only performed by collect_garbage()
+		};
+
+		MergeSettings *mergeSettings;
+		std::unique_ptr<MergeSettings> ownedMergeSettings;
+
+		// deferred merging: elements have been removed from the subtree of this node since the last collect_garbage()
+		bool mergePending;
+
+		// storage of the elements (see set_storage()). Owned by the root node (ownedStorageSettings).
+		struct StorageSettings
+		{
+			QuadtreeStorage policy = QUADTREE_STORAGE_SHARED;
+			Real looseness = 1;		// factor by which the width of the nodes is enlarged (1 -> exact bounds, only QUADTREE_STORAGE_LOOSE enlarges the nodes)
+			bool exactOverlap = false;	// shared storage: the elements are routed by their polygon instead of their AABB boundary box (see set_exact_overlap())
+		};
+
+		StorageSettings *storageSettings;
+		std::unique_ptr<StorageSettings> ownedStorageSettings;
+
+#ifdef QUADTREE_STATS
+		// operation counters and latency histograms (see stats()). Owned by the root node (ownedStatsCounters).
+		QuadtreeStatsCounters *statsCounters;
+		std::unique_ptr<QuadtreeStatsCounters> ownedStatsCounters;
+#endif
 
 		// pointer to the std::vectors containing all the points
-		std::vector<float> *ptrToX;
-		std::vector<float> *ptrToY;
+		std::vector<Scalar> *ptrToX;
+		std::vector<Scalar> *ptrToY;
 
 		// starting point in the vectors above (as well as the amount of points the 'shape' consists of)
 		// TODO: merge element_start and element_amount into a single std::vector<std::pair<int, int> > vec. Especially useful in concatenate_nodes -> removes duplicates from 
@@ -47,89 +287,406 @@ class Quadtree
 		std::vector<int> shared_element_start;
 		std::vector<int> shared_element_amount;
 
+#ifdef QUADTREE_FIXED_CONFIG
 		// minimum amount of pts to split the node
-		unsigned int maxAmtElements = 1;
+		static constexpr unsigned int maxAmtElements = QUADTREE_MAX_ELEMENTS;
 
 		// maximum depth of the children nodes
-		int maxDepth = 5;
+		static constexpr int maxDepth = QUADTREE_MAX_DEPTH;
+
+		static_assert((maxAmtElements >= 1) and (maxDepth >= 0), "invalid QUADTREE_MAX_ELEMENTS or QUADTREE_MAX_DEPTH");
+#else
+		// minimum amount of pts to split the node
+		unsigned int maxAmtElements;
+
+		// maximum depth of the children nodes
+		int maxDepth;
+#endif
 
 		// depth of the node (0...root node)
 		int nodeDepth;
 
 		// pointer to the parent node
-		Quadtree* parent;
+		BasicQuadtree* parent;
+
+		// constructor of the children nodes (used by subdivide)
+		BasicQuadtree(const Box &BB_init, BasicQuadtree *parent, int _nodeDepth);
 
 		// delete the children (leaf)nodes (NW, NE, SW, SE) of a specific node.
 		void clearNode();
 
 		// clear the tree
-		void clear(Quadtree *t);
+		void clear(BasicQuadtree *t);
 
-		// recursively remove a element from the shared space of all leafnodes containing a given node *t
-		void recursive_remove(Quadtree *t, int iStart, int iAmount);
+		// add an element to the (shared) space of the node *t
+		void push_element(BasicQuadtree *t, int iStart, int iAmount, bool shared);
+
+		// remove the element at the given slot from the (shared) space of the node *t (the last element is moved into the gap)
+		void erase_element(BasicQuadtree *t, int slot, bool shared);
+
+		// remove all slots of the node *t from the reverse index
+		void unindex_node(BasicQuadtree *t);
+
+		// change the slot of an element in the reverse index (newSlot == -1 -> remove the slot)
+		void index_replace_slot(int iStart, BasicQuadtree *t, int slot, bool shared, int newSlot);
+
+		// remove an element from all nodes of the subtree of *fetch_node (the deepest node in which the element resides) without concatenating nodes. Returns true if the element fitted completely into a leaf node.
+		bool remove_element(BasicQuadtree *fetch_node, int iStart, int iAmount);
+
+		// auxiliary function used by remove_element() if the reverse index is available
+		bool remove_element_indexed(int iStart, int iAmount);
 
-		// drawing routine (used by traverse_and_draw)
-		void colorPick(float elevate, Quadtree* t, float *depthColor, int depthColorLen);
+		// concatenate the nodes around *fetch_node (if possible) after an element has been removed by remove_element()
+		void concatenate_after_removal(BasicQuadtree *fetch_node, bool fullElement);
+
+		// recursively remove a element from the shared space of all leafnodes containing a given node *t
+		void recursive_remove(BasicQuadtree *t, int iStart, int iAmount);
 
 		// Used to collapse nodes and redistribute elements after collapsing.
-		void concatenate_nodes(Quadtree *concat_this_node_maybe);
+		void concatenate_nodes(BasicQuadtree *concat_this_node_maybe);
+
+		// move the elements of the four children nodes of *t into *t and delete the children (if all children are leaf nodes holding less elements than the merge threshold)
+		bool merge_children(BasicQuadtree *t);
+
+		// mark *t and its parent nodes for collect_garbage()
+		void defer_merge(BasicQuadtree *t);
+
+		// auxiliary function used by collect_garbage() (bottom up, only the marked nodes are visited)
+		int collect_garbage_internal(BasicQuadtree *t);
 
 		// fetch the (deepest) node in which the given element resides
-		Quadtree* fetch_deepest_node(int iStart, int iAmount);
+		BasicQuadtree* fetch_deepest_node(int iStart, int iAmount);
 
 		// auxiliary function used by fetch_deepest_node().
-		Quadtree* fetch_deepest_node_internal(Quadtree* t, int iStart, int iAmount, const std::vector<float> *vecSearchX = nullptr, const std::vector<float> *vecSearchY = nullptr);
+		BasicQuadtree* fetch_deepest_node_internal(BasicQuadtree* t, int iStart, int iAmount, const std::vector<Scalar> *vecSearchX = nullptr, const std::vector<Scalar> *vecSearchY = nullptr);
 
 		// auxiliary function used by fetch_elements().
-		void fetch_elements_internal2(std::set< std::pair<int,int> > &vec, Quadtree *t, float xmin, float xmax, float ymin, float ymax);
+		void fetch_elements_internal2(std::set< std::pair<int,int> > &vec, BasicQuadtree *t, Scalar xmin, Scalar xmax, Scalar ymin, Scalar ymax, int iStart, int iAmount);
 
- 		void recursive_removeAABB(Quadtree *t, float xmin, float xmax, float ymin, float ymax, int iStart, int iAmount);
+ 		void recursive_removeAABB(BasicQuadtree *t, Scalar xmin, Scalar xmax, Scalar ymin, Scalar ymax, int iStart, int iAmount);
 
-		// generate the AABB boundary box of an element (defined by iStart and iAmount)
-		std::tuple<float, float, float, float> genAABBBox(int iStart, int iAmount);
+		// generate the AABB boundary box of an element (defined by iStart and iAmount). Read from the cache if available.
+		std::tuple<Scalar, Scalar, Scalar, Scalar> genAABBBox(int iStart, int iAmount) const;
+
+		// generate the AABB boundary box of an element from its points and store it in the cache (called whenever an element is inserted from the root node or relocated)
+		std::tuple<Scalar, Scalar, Scalar, Scalar> refresh_AABB(int iStart, int iAmount);
+
+		// invalidate the cached AABB boundary box of an element leaving the tree (deleted, or rejected by insert() or relocate_element()), the slot may be reused for another element of the same amount of points
+		void forget_AABB(int iStart);
 
 		// recursively insert a element into all leaf nodes (deepest nodes possible) of a given node *t
-		void test2(Quadtree* t, float xmin, float xmax, float ymin, float ymax, int iStart, int iAmount);
+		void test2(BasicQuadtree* t, Scalar xmin, Scalar xmax, Scalar ymin, Scalar ymax, int iStart, int iAmount);
+
+		// the polygon of the element (iStart, iAmount) overlaps the (closed) box of the node *t (2 points: segment, 1 point: point, may be concave)
+		bool polygon_overlaps_node(const BasicQuadtree *t, int iStart, int iAmount) const;
+
+		// the element (iStart, iAmount) with the AABB boundary box (xmin, xmax, ymin, ymax) is routed into the node *t: the AABB boundary box overlaps the node and, for exact overlap tests (see set_exact_overlap()), so does the polygon
+		bool element_overlaps_node(const BasicQuadtree *t, Scalar xmin, Scalar xmax, Scalar ymin, Scalar ymax, int iStart, int iAmount) const
+		{
+			return t->boundary2.overlaps(xmin, xmax, ymin, ymax) and ((storageSettings->exactOverlap == false) or polygon_overlaps_node(t, iStart, iAmount));
+		}
+
+		// every element resides exactly once, in a single (leaf or inner) node, i.e., there is no shared space (QUADTREE_STORAGE_ENCLOSING and QUADTREE_STORAGE_LOOSE)
+		bool single_node_storage() const { return storageSettings->policy != QUADTREE_STORAGE_SHARED; }
+
+		// width of the node *t enlarged by the looseness factor (the width of the node unless the bounds are loose)
+		Real loose_dim(const BasicQuadtree *t) const { return t->boundary2.dim * storageSettings->looseness; }
+
+		// single node storage: deepest node of the subtree of *t enclosing the AABB boundary box of an element (enlarged bounds for QUADTREE_STORAGE_LOOSE), i.e., the node in which the element resides (on every level only the child node containing the center of the box is a candidate)
+		BasicQuadtree* fetch_enclosing_node(BasicQuadtree *t, Scalar xmin, Scalar xmax, Scalar ymin, Scalar ymax) const;
+
+		// single node storage: insert an element into the deepest node of the subtree of *t enclosing it (a full leaf node is split first)
+		void insert_enclosing(BasicQuadtree *t, Scalar xmin, Scalar xmax, Scalar ymin, Scalar ymax, int iStart, int iAmount);
+
+		// start a new query (invalidates the stamps of the previous query)
+		void next_query_epoch(QueryScratch &scratch) const;
+
+		// auxiliary function used by visit_elements() and fetch_elements_batch(). Only reads the tree (all state of the query resides in scratch).
+		template <typename Visitor>
+		void visit_elements_internal(const BasicQuadtree *t, Scalar xmin, Scalar xmax, Scalar ymin, Scalar ymax, int iStart, int iAmount, QueryScratch &scratch, Visitor &visitor) const;
+
+		// auxiliary functions used by query_aabb(), query_circle() and query_polygon(). Region provides overlaps() and contains() for the box of a node, a subtree whose node is contained in the region is reported without further tests.
+		template <typename Region>
+		void query_region(const Region &region, std::vector< std::pair<int,int> > &vec);
+
+		template <typename Region, typename Visitor>
+		void visit_region_internal(const BasicQuadtree *t, const Region &region, QueryScratch &scratch, Visitor &visitor) const;
+
+		template <typename Visitor>
+		void visit_subtree_internal(const BasicQuadtree *t, QueryScratch &scratch, Visitor &visitor) const;
+
+		// ray of raycast() (normalized direction, inverse direction for the slab tests)
+		struct Ray
+		{
+			Real ox, oy;
+			Real dx, dy;
+			Real invdx, invdy;
+			Real maxDist;
+			bool firstHitOnly;
+		};
+
+		// auxiliary function used by raycast(). Visits the leaf nodes hit by the ray front to back (children ordered by the distance at which the ray enters them). Returns true if the search can be stopped (firstHitOnly and no remaining node can contain a closer hit).
+		bool raycast_internal(const BasicQuadtree *t, const Ray &ray, Real tEnter, std::vector<Hit> &hits);
+
+		// used by collect_candidate_pairs() (sharedSlots: exact overlap tests only, the pairs of two shared elements are left to collect_candidate_pairs_shared(), the leaf nodes collect the slots of their shared elements instead)
+		void collect_candidate_pairs_internal(BasicQuadtree *t, std::vector<ElementPair> &pairs, std::vector< std::tuple<Scalar, Scalar, Scalar, Scalar> > &leafAABB, std::vector<ElementSlot> *sharedSlots);
+
+		// used by collect_candidate_pairs() with exact overlap tests: pairs the shared elements residing in a common leaf node (sharedSlots: slots of all shared elements, sorted by element)
+		void collect_candidate_pairs_shared(std::vector<ElementSlot> &sharedSlots, std::vector<ElementPair> &pairs);
 
 		// used by count_elements()
-		void count_elements_internal(Quadtree* t, std::set< std::pair<int, int> > &count_shared_elements);
+		void count_elements_internal(BasicQuadtree* t, std::set< std::pair<int, int> > &count_shared_elements);
+
+		// element (and its AABB boundary box) which is sorted into the tree by build() or paired by collect_candidate_pairs()
+		struct BuildElement
+		{
+			Scalar xmin, xmax, ymin, ymax;
+			int iStart, iAmount;
+		};
+
+		// used by collect_candidate_pairs() for single node storage (single traversal of the subtree of *t). stack[first, last): elements of other nodes which are paired with the elements of the subtree of *t (withinSubtree: the elements of the subtree are paired with each other as well)
+		void collect_candidate_pairs_enclosing(const BasicQuadtree *t, std::vector<ElementPair> &pairs, std::vector<BuildElement> &stack, int first, int last, bool withinSubtree);
+
+		// used by collect_candidate_pairs_enclosing(): pairs the elements of the subtree of *a with the elements of the subtree of *b (siblings or their descendants, only their loose bounds overlap)
+		void collect_candidate_pairs_cross(const BasicQuadtree *a, const BasicQuadtree *b, std::vector<ElementPair> &pairs, std::vector<BuildElement> &stack);
+
+		// elements[first, last) sorted into the node *t
+		struct BuildTask
+		{
+			BasicQuadtree *node;
+			int first, last;
+		};
+
+		// Parallel build: the nodes of depth taskDepth become independent tasks (subtrees) built by the worker threads. The shared elements of the nodes above are inserted after all tasks have been completed (in the order of a serial build).
+		struct BuildSchedule
+		{
+			int taskDepth;
+			std::vector<BuildTask> subtrees;
+			std::vector<BuildTask> shared;
+		};
+
+		// auxiliary function used by build(). Sorts the elements elements[first, last) (which all fit completely into the node *t) into the subtree of *t (schedule != nullptr -> the subtrees of depth schedule->taskDepth and the shared elements above are only scheduled).
+		void build_internal(BasicQuadtree *t, std::vector<BuildElement> &elements, std::vector<BuildElement> &scratch, std::vector<unsigned char> &bucket, int first, int last, BuildSchedule *schedule = nullptr);
 
 	public:
-		// constructor
-		Quadtree(std::shared_ptr<BoundaryBox> BB_init, Quadtree *parent, int _nodeDepth, std::vector<float>* iVecX, std::vector<float>* iVecY);
+		// constructor (the split threshold and the maximum depth are only used by a root node, i.e., parent == nullptr)
+		BasicQuadtree(std::shared_ptr<Box> BB_init, BasicQuadtree *parent, int _nodeDepth, std::vector<Scalar>* iVecX, std::vector<Scalar>* iVecY, unsigned int _maxAmtElements = QUADTREE_MAX_ELEMENTS, int _maxDepth = QUADTREE_MAX_DEPTH);
 
-		// relocate a single element
-		bool relocate_element(int index_search_start, int index_search_amount, const std::vector<float>* relocateOldCoordinatesx, const std::vector<float>* relocateOldCoordinatesy);
+		// relocate a single element (the element is only removed from and reinserted into the subtree of the smallest node containing the element pre and post movement)
+		bool relocate_element(int index_search_start, int index_search_amount, const std::vector<Scalar>* relocateOldCoordinatesx, const std::vector<Scalar>* relocateOldCoordinatesy);
 
 		// destructor
-		~Quadtree();
+		~BasicQuadtree();
+
+		// allocate the children nodes from a pool owned by the root node (has to be called on the root node before it is split)
+		bool enable_node_pool(int blocksPerChunk = 64);
+
+		// maintain a reverse index (element -> slots in the leaf nodes), i.e., delete_element() does not have to search the leaf nodes (has to be called on the root node)
+		bool enable_element_index();
 
 		// insert a point into the tree
 		bool insert(int iStart, int iAmount);
 
+		// bulk-load the tree from a complete list of elements (iStart, iAmount). Results in the same tree as calling insert() for every element, but every node is split only once. The subtrees are built by threadCount threads (threadCount <= 0 -> one thread per core), the resulting tree does not depend on threadCount. Single node storage (see set_storage()): the elements are inserted one by one (single thread).
+		bool build(const std::vector< std::pair<int, int> > &elements, int threadCount = 1);
+
 		// split the current node into four new (children)nodes (increment depth by one)
 		bool subdivide();
 
-		// draw the tree using OpenGL
-		void traverse_and_draw(Quadtree* t, float widthRootNode);
-
 		// count the nodes of the tree
-		int count_nodes(Quadtree *t);
+		int count_nodes(BasicQuadtree *t);
 
 		// count the elements residing in the tree
-		int count_elements(Quadtree *t);
+		int count_elements(BasicQuadtree *t);
 
 		// returns all possible colliding elements corresponding to the node in which this element (iStart, iAmount) resides
 		std::set< std::pair<int,int> > fetch_elements(int iStart, int iAmount);
 
+		// same as above, but the elements are appended to vec (which is not cleared, i.e., it can be reused across queries without allocating)
+		void fetch_elements(int iStart, int iAmount, std::vector< std::pair<int,int> > &vec);
+
+		// same as above, but calls visitor(iStart, iAmount) once for every element. The visitor must neither modify the tree nor query it.
+		template <typename Visitor>
+		void visit_elements(int iStart, int iAmount, Visitor &&visitor);
+
+		// Answers fetch_elements(queries[i].first, queries[i].second, results[i]) for all queries using threadCount threads (threadCount <= 0 -> one thread per core, the calling thread works as well and the worker threads are reused by the next call). results is resized to the amount of queries and every results[i] is cleared first (the capacity is kept). The tree is not modified during the call, but it must not be modified (or queried) by other threads either.
+		void fetch_elements_batch(const std::vector< std::pair<int,int> > &queries, std::vector< std::vector< std::pair<int,int> > > &results, int threadCount = 0);
+
+		// Region queries: append all elements residing in the leaf nodes touching the given region to vec (every element once, vec is not cleared), i.e., the possibly colliding elements (same as fetch_elements(), but for an arbitrary region instead of an element of the tree)
+		// axis aligned rectangle [xmin, xmax] x [ymin, ymax]
+		void query_aabb(Scalar xmin, Scalar xmax, Scalar ymin, Scalar ymax, std::vector< std::pair<int,int> > &vec);
+
+		// circle of radius r around (cx, cy)
+		void query_circle(Scalar cx, Scalar cy, Real r, std::vector< std::pair<int,int> > &vec);
+
+		// polygon (vertices (polygonX[i], polygonY[i]), may be concave)
+		void query_polygon(const std::vector<Scalar> &polygonX, const std::vector<Scalar> &polygonY, std::vector< std::pair<int,int> > &vec);
+
+		// Cast a ray from (ox, oy) in direction (dx, dy) up to the distance maxDist. All elements hit by the ray are written to hits (cleared first) sorted by increasing distance (ties: increasing iStart), or only the closest one if firstHitOnly. Elements are treated as closed polygons (2 points: a segment, 1 point: a point), an element containing the origin is hit at distance 0. Only the parts of the elements inside the root node are hit.
+		void raycast(Scalar ox, Scalar oy, Real dx, Real dy, Real maxDist, std::vector<Hit> &hits, bool firstHitOnly = false);
+
+		// same as above for the segment from (ax, ay) to (bx, by)
+		void segment_query(Scalar ax, Scalar ay, Scalar bx, Scalar by, std::vector<Hit> &hits, bool firstHitOnly = false);
+
+		// Fetch the k elements closest to the point (px, py), i.e., the elements with the smallest distance from the point to one of their points (best-first search of the nodes). The elements are written to result (cleared first) sorted by increasing distance (ties: increasing iStart). Fewer than k elements are returned if the tree holds less elements.
+		void fetch_nearest_elements(Scalar px, Scalar py, int k, std::vector<Nearest> &result);
+
+		// returns every pair of elements which reside in a common leaf node and whose AABBs overlap (touching counts) exactly once (single traversal of the tree, startA < startB). The vector is cleared first.
+		void collect_candidate_pairs(std::vector<ElementPair> &pairs);
+
 		// remove a single element of the tree
 		bool delete_element(int iStart, int iAmount);
 
-		// debuggingfunctions
-		// visualizes the nodes, which can be concatenated (colored) and the nodes which only inherits elements in the shared space (shared_element_start, shared_element_amount).  The latter are colored grey.
-		void find_concatenable_shared_nodes(Quadtree *t);
+		// Four leaf nodes are merged into their parent node if they hold less than threshold elements (default: the split threshold, 0 -> never merge). A threshold below the split threshold keeps nodes split while the amount of elements oscillates around the split threshold. Has to be called on the root node, threshold must not exceed the split threshold.
+		bool set_merge_threshold(unsigned int threshold);
+		unsigned int merge_threshold() const { return mergeSettings->threshold; }
+
+		// Deferred merging: delete_element() and relocate_element() only mark the nodes, the merges are performed by collect_garbage() (e.g. at the end of a frame). Disabling it collects the garbage. Has to be called on the root node.
+		bool set_deferred_merging(bool deferred);
+
+		// perform all pending merges in a single bottom up pass over the marked nodes. Returns the amount of merges. Has to be called on the root node.
+		int collect_garbage();
+
+		// Storage of the elements straddling the border of a node. QUADTREE_STORAGE_SHARED (default): copied into the shared space of all leaf nodes they overlap. QUADTREE_STORAGE_ENCLOSING: every element resides exactly once, in the smallest node enclosing it (inner nodes keep the elements which fit into none of their children, the queries collect them on the way down). QUADTREE_STORAGE_LOOSE: same, but the width of every node is enlarged by the factor looseness (>= 1, typically 2) around its center, i.e., small elements close to the border of a node still fit into a child node. Has to be called on the root node of an empty tree. Snapshots are only available for QUADTREE_STORAGE_SHARED.
+		bool set_storage(QuadtreeStorage policy, Real looseness = 2);
+		QuadtreeStorage storage() const { return storageSettings->policy; }
+		Real looseness() const { return storageSettings->looseness; }
+
+		// looseness > 1: QUADTREE_STORAGE_LOOSE, looseness == 1: QUADTREE_STORAGE_SHARED (see set_storage())
+		bool set_loose_bounds(Real looseness);
+
+		// Exact overlap tests (shared storage only, has to be called on the root node of an empty tree): an element straddling the border of a node is only copied into the leaf nodes its polygon overlaps instead of all leaf nodes its AABB boundary box overlaps (e.g., long diagonal elements), fetch_elements(), visit_elements(), fetch_elements_batch() and the deletions only descend into these nodes. collect_candidate_pairs() pairs the shared elements per element instead of per leaf node, i.e., all leaf nodes holding an element are searched at once and the stamps of the queries deduplicate its partners (the leaf node containing the corner of the intersection of their AABBs may hold neither element). Elements whose points all lie outside of the root node are inserted if their polygon overlaps the root node. Snapshots are not available with exact overlap tests.
+		bool set_exact_overlap(bool enable);
+		bool exact_overlap() const { return storageSettings->exactOverlap; }
+
+		// Write the tree into a binary snapshot file (see quadtree_snapshot.h), including the point vectors if includePoints. Has to be called on the root node, returns false if the file cannot be written. Snapshots store float coordinates, i.e., only available for Quadtree.
+		bool save_snapshot(const std::string &path, bool includePoints = true) const;
+
+		// Replace the tree by the tree of an opened snapshot (single pass over the nodes, no insertion). The boundary box, split threshold and maximum depth have to match. The points of the snapshot (if stored) are copied into the point vectors of the tree. Has to be called on the root node (only available for Quadtree).
+		bool load_snapshot(const QuadtreeSnapshot &snapshot);
+
+		// snapshot of the operation counters and latency histograms since the last reset_stats() (all zeros if the tree is compiled without QUADTREE_STATS)
+		QuadtreeStats stats() const;
+
+		// reset the counters (e.g. once per frame)
+		void reset_stats();
+
+		// read-only access to the nodes (e.g. for drawing the tree, see quadtree_draw.h)
+		// dimensions of the node
+		const Box &boundary() const { return boundary2; }
+
+		// depth of the node (0...root node)
+		int depth() const { return nodeDepth; }
+
+		// true if the node has not been split
+		bool is_leaf() const { return northWest == nullptr; }
+
+		// parent node (nullptr for the root node)
+		const BasicQuadtree *parent_node() const { return (parent == this) ? nullptr : parent; }
+
+		// children nodes (nullptr for a leaf node)
+		const BasicQuadtree *child_north_west() const { return northWest; }
+		const BasicQuadtree *child_north_east() const { return northEast; }
+		const BasicQuadtree *child_south_west() const { return southWest; }
+		const BasicQuadtree *child_south_east() const { return southEast; }
+
+		// elements residing completely in this node: (element_start[i], element_amount[i]), i = 0 ... amount_elements()-1 (single node storage, see set_storage(): inner nodes may hold elements as well)
+		int amount_elements() const { return element_start.size(); }
+		std::pair<int, int> element(int i) const { return std::make_pair(element_start[i], element_amount[i]); }
+
+		// elements in the shared space of this node
+		int amount_shared_elements() const { return shared_element_start.size(); }
+		std::pair<int, int> shared_element(int i) const { return std::make_pair(shared_element_start[i], shared_element_amount[i]); }
+
+		// changes whenever a node of the tree is split or merged (e.g. to rebuild cached drawings of the nodes only if necessary)
+		uint64_t structure_version() const { return versions->structure.load(std::memory_order_relaxed); }
+
+		// changes whenever elements are inserted, deleted or relocated (or the structure changes)
+		uint64_t element_version() const { return versions->elements + structure_version(); }
 
+		// calls visitor(const BasicQuadtree &node) for every node of the subtree of this node (depth first, a node is visited before its children in the order NE, NW, SE, SW)
+		template <typename Visitor>
+		void visit_nodes(Visitor &&visitor) const;
+
+		// debuggingfunctions
 		// prints the tree (amount of elements in the vectors and the pointers to the nodes)
 		void print_tree();
 };
+
+// trees of the coordinate types (explicitly instantiated in quadtree.cpp)
+typedef BasicQuadtree<float> Quadtree;
+typedef BasicQuadtree<double> QuadtreeDouble;
+typedef BasicQuadtree<int32_t> QuadtreeFixed;
+
+template <typename Scalar>
+template <typename Visitor>
+void BasicQuadtree<Scalar>::visit_elements(int iStart, int iAmount, Visitor &&visitor)
+{
+	QUADTREE_STATS_TIMER(QUADTREE_OP_FETCH);
+
+	next_query_epoch(queryScratch);
+
+	auto returnAABB = genAABBBox(iStart, iAmount);
+
+	visit_elements_internal(this, std::get<0>(returnAABB), std::get<1>(returnAABB), std::get<2>(returnAABB), std::get<3>(returnAABB), iStart, iAmount, queryScratch, visitor);
+
+	QUADTREE_STATS_ADD(queries, 1);
+	QUADTREE_STATS_ADD(nodeVisits, queryScratch.nodeVisits);
+	QUADTREE_STATS_ONLY(queryScratch.nodeVisits = 0);
+}
+
+template <typename Scalar>
+template <typename Visitor>
+void BasicQuadtree<Scalar>::visit_nodes(Visitor &&visitor) const
+{
+	visitor(*this);
+
+	if (northWest != nullptr)	// this node has been split yet -> != nullptr
+	{
+		northEast->visit_nodes(visitor);
+		northWest->visit_nodes(visitor);
+		southEast->visit_nodes(visitor);
+		southWest->visit_nodes(visitor);
+	}
+}
+
+template <typename Scalar>
+template <typename Visitor>
+void BasicQuadtree<Scalar>::visit_elements_internal(const BasicQuadtree *t, Scalar xmin, Scalar xmax, Scalar ymin, Scalar ymax, int iStart, int iAmount, QueryScratch &scratch, Visitor &visitor) const
+{
+	QUADTREE_STATS_ONLY(scratch.nodeVisits++);
+
+	// no collision (exact overlap tests: the polygon of the element misses the node)
+	if ((t->boundary2.overlaps_loose(xmin, xmax, ymin, ymax, loose_dim(t)) == false) or (storageSettings->exactOverlap and (polygon_overlaps_node(t, iStart, iAmount) == false)))
+	{
+		return;
+	}
+
+	// elements which fit completely into this node reside in no other node (only inner nodes of loose trees hold elements besides the leaf nodes)
+	for (int i = 0; i < (int)t->element_start.size(); i++)
+	{
+		visitor(t->element_start[i], t->element_amount[i]);
+	}
+
+	if (t->northWest != nullptr)	// this node has been split yet -> != nullptr
+	{
+		visit_elements_internal(t->northEast, xmin, xmax, ymin, ymax, iStart, iAmount, scratch, visitor);
+		visit_elements_internal(t->northWest, xmin, xmax, ymin, ymax, iStart, iAmount, scratch, visitor);
+		visit_elements_internal(t->southEast, xmin, xmax, ymin, ymax, iStart, iAmount, scratch, visitor);
+		visit_elements_internal(t->southWest, xmin, xmax, ymin, ymax, iStart, iAmount, scratch, visitor);
+		return;
+	}
+
+	// shared elements reside in several leaf nodes -> report them only once per query
+	for (int i = 0; i < (int)t->shared_element_start.size(); i++)
+	{
+		int sharedStart = t->shared_element_start[i];
+
+		if (scratch.stamp[sharedStart] != scratch.epoch)
+		{
+			scratch.stamp[sharedStart] = scratch.epoch;
+			visitor(sharedStart, t->shared_element_amount[i]);
+		}
+	}
+}
 #endif
@@ -0,0 +1,203 @@
+// drawing routines of the quadtree
+#include <iostream>
+#include <cstdlib>
+
+#include <GL/glut.h>
+#include <GL/gl.h>
+
+#include "quadtree_draw.h"
+
+namespace
+{
+	// adjust the height (z-coordinate) of the quadtree
+	const float elevate = -10.0f;
+
+	// pick the colors according to the depth
+	const float depthColor [] = 
+	{
+		1.0f, 0.0f, 0.0f,		// depth 1 = red
+		0.0f, 0.392f, 0.0f,		// depth 2 = darkgreen
+		0.0f, 0.0f, 1.0f,		// depth 3 = blue
+		1.0f, 0.0f, 1.0f,		// depth 4 = purple
+		0.0f, 1.0f, 1.0f, 		// depth 5 = cyan
+		0.294f, 0.0f, 0.51f,	// depth 6 = indigo
+		0.863f, 0.078f, 0.235f,	// depth 6 = Crimson
+	};
+
+	const int depthColorLen = sizeof(depthColor)/sizeof(*depthColor);
+
+	// colors of the concatenable nodes (NW, NE, SW, SE) and of the nodes only inheriting shared elements
+	const float concatColor[4][4] =
+	{
+		{1.0f, 0.0f, 0.0f, 0.15f},
+		{0.0f, 1.0f, 0.0f, 0.15f},
+		{0.0f, 0.0f, 1.0f, 0.15f},
+		{1.0f, 0.0f, 1.0f, 0.15f}
+	};
+
+	const float sharedColor[4] = {0.0f, 0.0f, 0.0f, 0.25f};
+}
+
+void QuadtreeRenderer::VertexArray::clear()
+{
+	vertices.clear();
+	colors.clear();
+}
+
+void QuadtreeRenderer::VertexArray::push_vertex(float x, float y, float z, const float *rgba)
+{
+	vertices.push_back(x);
+	vertices.push_back(y);
+	vertices.push_back(z);
+
+	colors.insert(colors.end(), rgba, rgba+4);
+}
+
+void QuadtreeRenderer::VertexArray::draw(unsigned int mode) const
+{
+	if (vertices.empty())
+	{
+		return;
+	}
+
+	glEnableClientState(GL_VERTEX_ARRAY);
+	glEnableClientState(GL_COLOR_ARRAY);
+
+	glVertexPointer(3, GL_FLOAT, 0, vertices.data());
+	glColorPointer(4, GL_FLOAT, 0, colors.data());
+
+	glDrawArrays(mode, 0, vertices.size()/3);
+
+	glDisableClientState(GL_COLOR_ARRAY);
+	glDisableClientState(GL_VERTEX_ARRAY);
+}
+
+// collect the split lines of all nodes
+void QuadtreeRenderer::build_lines(const Quadtree *t)
+{
+	lines.clear();
+
+	t->visit_nodes([this](const Quadtree &node)
+	{
+		// only nodes which have been split are divided by lines
+		if (node.is_leaf())
+		{
+			return;
+		}
+
+		float rgba[4] = {0.0f, 0.0f, 0.0f, 1.0f};	// default color when the depth exceeds the available colors from the array
+
+		if (node.depth()*3+2 <= depthColorLen)	// pick a color according to the array
+		{
+			rgba[0] = depthColor[node.depth()*3];
+			rgba[1] = depthColor[node.depth()*3+1];
+			rgba[2] = depthColor[node.depth()*3+2];
+		}
+
+		float centerx = node.boundary().cx;
+		float centery = node.boundary().cy;
+		float dim = node.boundary().dim;
+
+		lines.push_vertex(centerx-dim, centery, elevate, rgba);
+		lines.push_vertex(centerx+dim, centery, elevate, rgba);
+
+		lines.push_vertex(centerx, centery-dim, elevate, rgba);
+		lines.push_vertex(centerx, centery+dim, elevate, rgba);
+	});
+
+	lines.tree = t;
+	lines.version = t->structure_version();
+}
+
+// collect the nodes which can be concatenated
+void QuadtreeRenderer::build_quads(const Quadtree *t)
+{
+	quads.clear();
+
+	t->visit_nodes([this](const Quadtree &node)
+	{
+		// anything NOT in the deepest node should evoke an error (except for the single node storage, where inner nodes hold elements as well)
+		if ((node.is_leaf() == false) and (node.parent_node() != nullptr) and (node.storage() == QUADTREE_STORAGE_SHARED))
+		{
+			if ((node.amount_elements() > 0) or (node.amount_shared_elements() > 0))
+			{
+				std::cout << "elements not in deepest node" << std::endl;
+	 			exit(1);
+			}
+		}
+
+		if (node.is_leaf())
+		{
+			return;
+		}
+
+		const Quadtree *children[4] = {node.child_north_west(), node.child_north_east(), node.child_south_west(), node.child_south_east()};
+
+		// the four children nodes have to be leaf nodes (deepest nodes of the QT)
+		bool color_overwrite = true;
+
+		for (int i = 0; i < 4; i++)
+		{
+			if (children[i]->is_leaf() == false)
+			{
+				return;
+			}
+
+			if (children[i]->amount_elements() > 0)
+			{
+				color_overwrite = false;
+			}
+		}
+
+		// two triangles per node
+		for (int i = 0; i < 4; i++)
+		{
+			const float *rgba = (color_overwrite == false) ? concatColor[i] : sharedColor;
+
+			float centerx = children[i]->boundary().cx;
+			float centery = children[i]->boundary().cy;
+			float dim = children[i]->boundary().dim;
+
+			quads.push_vertex(centerx+dim, centery+dim, elevate, rgba);
+			quads.push_vertex(centerx+dim, centery-dim, elevate, rgba);
+			quads.push_vertex(centerx-dim, centery+dim, elevate, rgba);
+
+			quads.push_vertex(centerx+dim, centery-dim, elevate, rgba);
+			quads.push_vertex(centerx-dim, centery+dim, elevate, rgba);
+			quads.push_vertex(centerx-dim, centery-dim, elevate, rgba);
+		}
+	});
+
+	quads.tree = t;
+	quads.version = t->element_version();
+}
+
+// draw the tree using OpenGL
+void QuadtreeRenderer::traverse_and_draw(const Quadtree *t)
+{
+	if ((lines.tree != t) or (lines.version != t->structure_version()))
+	{
+		build_lines(t);
+	}
+
+	glLineWidth(1.0f);
+
+	lines.draw(GL_LINES);
+}
+
+// visualizes the nodes, which can be concatenated (colored) and the nodes which only inherits elements in the shared space. The latter are colored grey.
+void QuadtreeRenderer::find_concatenable_shared_nodes(const Quadtree *t)
+{
+	if ((quads.tree != t) or (quads.version != t->element_version()))
+	{
+		build_quads(t);
+	}
+
+	quads.draw(GL_TRIANGLES);
+}
+
+void QuadtreeRenderer::invalidate()
+{
+	lines.tree = nullptr;
+	quads.tree = nullptr;
+}
@@ -0,0 +1,53 @@
+// drawing routines of the quadtree (OpenGL, debug renderer)
+#ifndef __QUADTREE_DRAW_H_INCLUDED__
+#define __QUADTREE_DRAW_H_INCLUDED__
+
+#include <vector>
+#include <cstdint>
+
+#include "quadtree.h"
+
+// Draws the tree using OpenGL. The renderer only reads the tree (public traversal API of Quadtree), i.e., the quadtree library itself does not depend on OpenGL.
+// All lines (quads) are collected into a single vertex array, which is drawn by a single glDrawArrays call. The vertex arrays are only rebuilt if the tree has been modified since the last call (structure_version(), element_version()).
+class QuadtreeRenderer
+{
+	private:
+		// vertex array (x, y, z) and color array (r, g, b, a) of a drawing
+		struct VertexArray
+		{
+			std::vector<float> vertices;
+			std::vector<float> colors;
+
+			// tree and its version the arrays have been built from
+			const Quadtree *tree = nullptr;
+			uint64_t version = 0;
+
+			void clear();
+			void push_vertex(float x, float y, float z, const float *rgba);
+			void draw(unsigned int mode) const;
+		};
+
+		// split lines of the nodes
+		VertexArray lines;
+
+		// nodes which can be concatenated
+		VertexArray quads;
+
+		// collect the split lines of all nodes (colored according to their depth)
+		void build_lines(const Quadtree *t);
+
+		// collect the nodes which can be concatenated
+		void build_quads(const Quadtree *t);
+
+	public:
+		// draw the tree (the split lines of the nodes, colored according to their depth)
+		void traverse_and_draw(const Quadtree *t);
+
+		// debuggingfunctions
+		// visualizes the nodes, which can be concatenated (colored) and the nodes which only inherits elements in the shared space (shared_element_start, shared_element_amount).  The latter are colored grey.
+		void find_concatenable_shared_nodes(const Quadtree *t);
+
+		// rebuild the vertex arrays on the next call (e.g. if another tree is stored at the address of a deleted tree)
+		void invalidate();
+};
+#endif
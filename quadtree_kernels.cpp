@@ -0,0 +1,363 @@
+// kernels of the per-point loops
+#include <limits>
+#include <cstdint>		// int32_t
+#include <algorithm>	// std::min, std::max
+
+#if defined(__GNUC__) and (defined(__x86_64__) or defined(__i386__))
+	#define QUADTREE_KERNELS_X86
+	#include <immintrin.h>
+#endif
+
+#include "quadtree_kernels.h"
+
+namespace
+{
+	typedef int (*CountInsideKernel)(const float *, const float *, int, float, float, float, float);
+	typedef void (*AABBKernel)(const float *, const float *, int, float &, float &, float &, float &);
+	typedef float (*DistanceKernel)(const float *, const float *, int, float, float);
+
+	// the vectorized kernels only pay off for elements with several points
+	const int minVectorAmount = 8;
+
+	template <typename Scalar>
+	int count_points_inside_scalar(const Scalar *x, const Scalar *y, int amount, Scalar xmin, Scalar xmax, Scalar ymin, Scalar ymax)
+	{
+		int count_inside = amount;
+
+		for (int i = 0; i < amount; i++)
+		{
+			if (x[i] > xmax or x[i] <= xmin or y[i] > ymax or y[i] <= ymin)
+			{
+				count_inside--;
+			}
+		}
+
+		return count_inside;
+	}
+
+	template <typename Scalar>
+	void points_AABB_scalar(const Scalar *x, const Scalar *y, int amount, Scalar &xmin, Scalar &xmax, Scalar &ymin, Scalar &ymax)
+	{
+		for (int i = 0; i < amount; i++)
+		{
+			xmin = std::min(xmin, x[i]);
+			xmax = std::max(xmax, x[i]);
+			ymin = std::min(ymin, y[i]);
+			ymax = std::max(ymax, y[i]);
+		}
+	}
+
+	// Real: type of the distances (the differences of integer coordinates are computed in double)
+	template <typename Scalar, typename Real>
+	Real min_squared_distance_scalar(const Scalar *x, const Scalar *y, int amount, Scalar px, Scalar py)
+	{
+		Real distance = std::numeric_limits<Real>::max();
+
+		for (int i = 0; i < amount; i++)
+		{
+			Real dx = (Real)x[i]-(Real)px;
+			Real dy = (Real)y[i]-(Real)py;
+
+			distance = std::min(distance, dx*dx + dy*dy);
+		}
+
+		return distance;
+	}
+
+#ifdef QUADTREE_KERNELS_X86
+	__attribute__((target("sse2"))) int count_points_inside_sse2(const float *x, const float *y, int amount, float xmin, float xmax, float ymin, float ymax)
+	{
+		const __m128 vxmin = _mm_set1_ps(xmin);
+		const __m128 vxmax = _mm_set1_ps(xmax);
+		const __m128 vymin = _mm_set1_ps(ymin);
+		const __m128 vymax = _mm_set1_ps(ymax);
+
+		int count_outside = 0;
+		int i = 0;
+
+		for (; i+4 <= amount; i += 4)
+		{
+			__m128 vx = _mm_loadu_ps(x+i);
+			__m128 vy = _mm_loadu_ps(y+i);
+
+			// same comparisons as the scalar kernel (a point is outside if any of them holds)
+			__m128 outside = _mm_or_ps(_mm_or_ps(_mm_cmpgt_ps(vx, vxmax), _mm_cmple_ps(vx, vxmin)), _mm_or_ps(_mm_cmpgt_ps(vy, vymax), _mm_cmple_ps(vy, vymin)));
+
+			count_outside += __builtin_popcount(_mm_movemask_ps(outside));
+		}
+
+		return (i-count_outside) + count_points_inside_scalar(x+i, y+i, amount-i, xmin, xmax, ymin, ymax);
+	}
+
+	__attribute__((target("sse2"))) void points_AABB_sse2(const float *x, const float *y, int amount, float &xmin, float &xmax, float &ymin, float &ymax)
+	{
+		__m128 vxmin = _mm_set1_ps(xmin);
+		__m128 vxmax = _mm_set1_ps(xmax);
+		__m128 vymin = _mm_set1_ps(ymin);
+		__m128 vymax = _mm_set1_ps(ymax);
+
+		int i = 0;
+
+		for (; i+4 <= amount; i += 4)
+		{
+			__m128 vx = _mm_loadu_ps(x+i);
+			__m128 vy = _mm_loadu_ps(y+i);
+
+			vxmin = _mm_min_ps(vxmin, vx);
+			vxmax = _mm_max_ps(vxmax, vx);
+			vymin = _mm_min_ps(vymin, vy);
+			vymax = _mm_max_ps(vymax, vy);
+		}
+
+		alignas(16) float lanes[4][4];
+		_mm_store_ps(lanes[0], vxmin);
+		_mm_store_ps(lanes[1], vxmax);
+		_mm_store_ps(lanes[2], vymin);
+		_mm_store_ps(lanes[3], vymax);
+
+		for (int k = 0; k < 4; k++)
+		{
+			xmin = std::min(xmin, lanes[0][k]);
+			xmax = std::max(xmax, lanes[1][k]);
+			ymin = std::min(ymin, lanes[2][k]);
+			ymax = std::max(ymax, lanes[3][k]);
+		}
+
+		points_AABB_scalar(x+i, y+i, amount-i, xmin, xmax, ymin, ymax);
+	}
+
+	__attribute__((target("sse2"))) float min_squared_distance_sse2(const float *x, const float *y, int amount, float px, float py)
+	{
+		const __m128 vpx = _mm_set1_ps(px);
+		const __m128 vpy = _mm_set1_ps(py);
+		__m128 vdistance = _mm_set1_ps(std::numeric_limits<float>::max());
+
+		int i = 0;
+
+		for (; i+4 <= amount; i += 4)
+		{
+			__m128 dx = _mm_sub_ps(_mm_loadu_ps(x+i), vpx);
+			__m128 dy = _mm_sub_ps(_mm_loadu_ps(y+i), vpy);
+
+			vdistance = _mm_min_ps(vdistance, _mm_add_ps(_mm_mul_ps(dx, dx), _mm_mul_ps(dy, dy)));
+		}
+
+		alignas(16) float lanes[4];
+		_mm_store_ps(lanes, vdistance);
+
+		float distance = min_squared_distance_scalar<float, float>(x+i, y+i, amount-i, px, py);
+
+		for (int k = 0; k < 4; k++)
+		{
+			distance = std::min(distance, lanes[k]);
+		}
+
+		return distance;
+	}
+
+	__attribute__((target("avx2"))) int count_points_inside_avx2(const float *x, const float *y, int amount, float xmin, float xmax, float ymin, float ymax)
+	{
+		const __m256 vxmin = _mm256_set1_ps(xmin);
+		const __m256 vxmax = _mm256_set1_ps(xmax);
+		const __m256 vymin = _mm256_set1_ps(ymin);
+		const __m256 vymax = _mm256_set1_ps(ymax);
+
+		int count_outside = 0;
+		int i = 0;
+
+		for (; i+8 <= amount; i += 8)
+		{
+			__m256 vx = _mm256_loadu_ps(x+i);
+			__m256 vy = _mm256_loadu_ps(y+i);
+
+			// same comparisons as the scalar kernel (a point is outside if any of them holds)
+			__m256 outside = _mm256_or_ps(_mm256_or_ps(_mm256_cmp_ps(vx, vxmax, _CMP_GT_OQ), _mm256_cmp_ps(vx, vxmin, _CMP_LE_OQ)), _mm256_or_ps(_mm256_cmp_ps(vy, vymax, _CMP_GT_OQ), _mm256_cmp_ps(vy, vymin, _CMP_LE_OQ)));
+
+			count_outside += __builtin_popcount(_mm256_movemask_ps(outside));
+		}
+
+		return (i-count_outside) + count_points_inside_scalar(x+i, y+i, amount-i, xmin, xmax, ymin, ymax);
+	}
+
+	__attribute__((target("avx2"))) void points_AABB_avx2(const float *x, const float *y, int amount, float &xmin, float &xmax, float &ymin, float &ymax)
+	{
+		__m256 vxmin = _mm256_set1_ps(xmin);
+		__m256 vxmax = _mm256_set1_ps(xmax);
+		__m256 vymin = _mm256_set1_ps(ymin);
+		__m256 vymax = _mm256_set1_ps(ymax);
+
+		int i = 0;
+
+		for (; i+8 <= amount; i += 8)
+		{
+			__m256 vx = _mm256_loadu_ps(x+i);
+			__m256 vy = _mm256_loadu_ps(y+i);
+
+			vxmin = _mm256_min_ps(vxmin, vx);
+			vxmax = _mm256_max_ps(vxmax, vx);
+			vymin = _mm256_min_ps(vymin, vy);
+			vymax = _mm256_max_ps(vymax, vy);
+		}
+
+		alignas(32) float lanes[4][8];
+		_mm256_store_ps(lanes[0], vxmin);
+		_mm256_store_ps(lanes[1], vxmax);
+		_mm256_store_ps(lanes[2], vymin);
+		_mm256_store_ps(lanes[3], vymax);
+
+		for (int k = 0; k < 8; k++)
+		{
+			xmin = std::min(xmin, lanes[0][k]);
+			xmax = std::max(xmax, lanes[1][k]);
+			ymin = std::min(ymin, lanes[2][k]);
+			ymax = std::max(ymax, lanes[3][k]);
+		}
+
+		points_AABB_scalar(x+i, y+i, amount-i, xmin, xmax, ymin, ymax);
+	}
+	__attribute__((target("avx2"))) float min_squared_distance_avx2(const float *x, const float *y, int amount, float px, float py)
+	{
+		const __m256 vpx = _mm256_set1_ps(px);
+		const __m256 vpy = _mm256_set1_ps(py);
+		__m256 vdistance = _mm256_set1_ps(std::numeric_limits<float>::max());
+
+		int i = 0;
+
+		for (; i+8 <= amount; i += 8)
+		{
+			__m256 dx = _mm256_sub_ps(_mm256_loadu_ps(x+i), vpx);
+			__m256 dy = _mm256_sub_ps(_mm256_loadu_ps(y+i), vpy);
+
+			vdistance = _mm256_min_ps(vdistance, _mm256_add_ps(_mm256_mul_ps(dx, dx), _mm256_mul_ps(dy, dy)));
+		}
+
+		alignas(32) float lanes[8];
+		_mm256_store_ps(lanes, vdistance);
+
+		float distance = min_squared_distance_scalar<float, float>(x+i, y+i, amount-i, px, py);
+
+		for (int k = 0; k < 8; k++)
+		{
+			distance = std::min(distance, lanes[k]);
+		}
+
+		return distance;
+	}
+#endif
+
+	// kernels selected for the CPU the program runs on
+	struct Kernels
+	{
+		CountInsideKernel count_inside;
+		AABBKernel aabb;
+		DistanceKernel distance;
+		const char *instructionSet;
+	};
+
+	Kernels select_kernels()
+	{
+#ifdef QUADTREE_KERNELS_X86
+		__builtin_cpu_init();
+
+		if (__builtin_cpu_supports("avx2"))
+		{
+			return {count_points_inside_avx2, points_AABB_avx2, min_squared_distance_avx2, "avx2"};
+		}
+
+		if (__builtin_cpu_supports("sse2"))
+		{
+			return {count_points_inside_sse2, points_AABB_sse2, min_squared_distance_sse2, "sse2"};
+		}
+#endif
+
+		return {count_points_inside_scalar<float>, points_AABB_scalar<float>, min_squared_distance_scalar<float, float>, "scalar"};
+	}
+
+	const Kernels &kernels()
+	{
+		static const Kernels selected = select_kernels();
+		return selected;
+	}
+}
+
+int count_points_inside(const float *x, const float *y, int amount, float xmin, float xmax, float ymin, float ymax)
+{
+	if (amount < minVectorAmount)
+	{
+		return count_points_inside_scalar<float>(x, y, amount, xmin, xmax, ymin, ymax);
+	}
+
+	return kernels().count_inside(x, y, amount, xmin, xmax, ymin, ymax);
+}
+
+void points_AABB(const float *x, const float *y, int amount, float &xmin, float &xmax, float &ymin, float &ymax)
+{
+	xmin = std::numeric_limits<float>::max();
+	xmax = -std::numeric_limits<float>::max();
+	ymin = std::numeric_limits<float>::max();
+	ymax = -std::numeric_limits<float>::max();
+
+	if (amount < minVectorAmount)
+	{
+		points_AABB_scalar(x, y, amount, xmin, xmax, ymin, ymax);
+		return;
+	}
+
+	kernels().aabb(x, y, amount, xmin, xmax, ymin, ymax);
+}
+
+float min_squared_distance(const float *x, const float *y, int amount, float px, float py)
+{
+	if (amount < minVectorAmount)
+	{
+		return min_squared_distance_scalar<float, float>(x, y, amount, px, py);
+	}
+
+	return kernels().distance(x, y, amount, px, py);
+}
+
+// double and integer coordinates (scalar kernels)
+int count_points_inside(const double *x, const double *y, int amount, double xmin, double xmax, double ymin, double ymax)
+{
+	return count_points_inside_scalar(x, y, amount, xmin, xmax, ymin, ymax);
+}
+
+int count_points_inside(const int32_t *x, const int32_t *y, int amount, int32_t xmin, int32_t xmax, int32_t ymin, int32_t ymax)
+{
+	return count_points_inside_scalar(x, y, amount, xmin, xmax, ymin, ymax);
+}
+
+void points_AABB(const double *x, const double *y, int amount, double &xmin, double &xmax, double &ymin, double &ymax)
+{
+	xmin = std::numeric_limits<double>::max();
+	xmax = std::numeric_limits<double>::lowest();
+	ymin = std::numeric_limits<double>::max();
+	ymax = std::numeric_limits<double>::lowest();
+
+	points_AABB_scalar(x, y, amount, xmin, xmax, ymin, ymax);
+}
+
+void points_AABB(const int32_t *x, const int32_t *y, int amount, int32_t &xmin, int32_t &xmax, int32_t &ymin, int32_t &ymax)
+{
+	xmin = std::numeric_limits<int32_t>::max();
+	xmax = std::numeric_limits<int32_t>::lowest();
+	ymin = std::numeric_limits<int32_t>::max();
+	ymax = std::numeric_limits<int32_t>::lowest();
+
+	points_AABB_scalar(x, y, amount, xmin, xmax, ymin, ymax);
+}
+
+double min_squared_distance(const double *x, const double *y, int amount, double px, double py)
+{
+	return min_squared_distance_scalar<double, double>(x, y, amount, px, py);
+}
+
+double min_squared_distance(const int32_t *x, const int32_t *y, int amount, int32_t px, int32_t py)
+{
+	return min_squared_distance_scalar<int32_t, double>(x, y, amount, px, py);
+}
+
+const char *kernels_instruction_set()
+{
+	return kernels().instructionSet;
+}
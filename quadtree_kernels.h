@@ -0,0 +1,26 @@
+// kernels of the per-point loops (shared by Quadtree and LinearQuadtree)
+#ifndef __QUADTREE_KERNELS_H_INCLUDED__
+#define __QUADTREE_KERNELS_H_INCLUDED__
+
+#include <cstdint>	// int32_t
+
+// The float kernels are vectorized (AVX2 or SSE2, selected at runtime depending on the CPU) with a scalar fallback. The double and integer (fixed-point) overloads are scalar.
+
+// amount of the points (x[i], y[i]), i = 0 ... amount-1, residing inside the box (xmin, xmax] x (ymin, ymax], i.e., inside a node
+int count_points_inside(const float *x, const float *y, int amount, float xmin, float xmax, float ymin, float ymax);
+int count_points_inside(const double *x, const double *y, int amount, double xmin, double xmax, double ymin, double ymax);
+int count_points_inside(const int32_t *x, const int32_t *y, int amount, int32_t xmin, int32_t xmax, int32_t ymin, int32_t ymax);
+
+// AABB boundary box of the points (x[i], y[i]), i = 0 ... amount-1 (amount == 0 -> xmin = ymin = max(), xmax = ymax = lowest() of the coordinate type)
+void points_AABB(const float *x, const float *y, int amount, float &xmin, float &xmax, float &ymin, float &ymax);
+void points_AABB(const double *x, const double *y, int amount, double &xmin, double &xmax, double &ymin, double &ymax);
+void points_AABB(const int32_t *x, const int32_t *y, int amount, int32_t &xmin, int32_t &xmax, int32_t &ymin, int32_t &ymax);
+
+// smallest squared distance of the points (x[i], y[i]), i = 0 ... amount-1, to the point (px, py) (amount == 0 -> max() of the returned type, integer coordinates: computed in double)
+float min_squared_distance(const float *x, const float *y, int amount, float px, float py);
+double min_squared_distance(const double *x, const double *y, int amount, double px, double py);
+double min_squared_distance(const int32_t *x, const int32_t *y, int amount, int32_t px, int32_t py);
+
+// instruction set used by the kernels ("avx2", "sse2" or "scalar")
+const char *kernels_instruction_set();
+#endif
@@ -0,0 +1,562 @@
+// binary snapshot of a quadtree
+#include <iostream>
+#include <fstream>
+#include <vector>
+#include <cstring>		// std::memcmp, std::memcpy
+#include <algorithm>	// std::fill
+#include <type_traits>
+
+#include <fcntl.h>		// open
+#include <unistd.h>		// close
+#include <sys/mman.h>	// mmap
+#include <sys/stat.h>	// fstat
+
+#include "quadtree.h"
+#include "quadtree_snapshot.h"
+#include "quadtree_kernels.h"
+
+namespace
+{
+	const char snapshotMagic[8] = {'Q', 'T', 'S', 'N', 'A', 'P', 0, 0};
+	const uint32_t snapshotByteOrder = 0x01020304;
+
+	// size of the payload of a snapshot with the given counts
+	uint64_t payload_size(uint64_t amtNodes, uint64_t amtEntries, uint64_t amtPoints, bool points)
+	{
+		return amtNodes*sizeof(QuadtreeSnapshotNode) + 2*amtEntries*sizeof(int32_t) + (points ? 2*amtPoints*sizeof(float) : 0);
+	}
+}
+
+uint64_t quadtree_snapshot_checksum(const void *data, std::size_t size, uint64_t hash)
+{
+	const unsigned char *bytes = static_cast<const unsigned char *>(data);
+
+	for (std::size_t i = 0; i < size; i++)
+	{
+		hash ^= bytes[i];
+		hash *= 1099511628211ULL;
+	}
+
+	return hash;
+}
+
+
+// constructor
+QuadtreeSnapshot::QuadtreeSnapshot()
+{
+	mapping = nullptr;
+	mappingSize = 0;
+
+	header = nullptr;
+	nodes = nullptr;
+	entryStart = nullptr;
+	entryAmount = nullptr;
+	pointsX = nullptr;
+	pointsY = nullptr;
+
+	epoch = 0;
+}
+
+// destructor
+QuadtreeSnapshot::~QuadtreeSnapshot()
+{
+	close();
+}
+
+bool QuadtreeSnapshot::open(const std::string &path, const std::vector<float> *iVecX, const std::vector<float> *iVecY, bool verifyChecksum)
+{
+	close();
+
+	int fd = ::open(path.c_str(), O_RDONLY);
+
+	if (fd < 0)
+	{
+		std::cout << "QuadtreeSnapshot -> cannot open " << path << std::endl;
+		return false;
+	}
+
+	struct stat fileStat;
+
+	if ((fstat(fd, &fileStat) != 0) or ((std::size_t)fileStat.st_size < sizeof(QuadtreeSnapshotHeader)))
+	{
+		std::cout << "QuadtreeSnapshot -> " << path << " is not a snapshot" << std::endl;
+		::close(fd);
+		return false;
+	}
+
+	void *address = mmap(nullptr, fileStat.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+	::close(fd);
+
+	if (address == MAP_FAILED)
+	{
+		std::cout << "QuadtreeSnapshot -> cannot map " << path << std::endl;
+		return false;
+	}
+
+	mapping = address;
+	mappingSize = fileStat.st_size;
+	header = static_cast<const QuadtreeSnapshotHeader *>(mapping);
+
+	if ((std::memcmp(header->magic, snapshotMagic, sizeof(snapshotMagic)) != 0) or (header->byteOrder != snapshotByteOrder))
+	{
+		std::cout << "QuadtreeSnapshot -> " << path << " is not a snapshot (or of another byte order)" << std::endl;
+		close();
+		return false;
+	}
+
+	if (header->version != QUADTREE_SNAPSHOT_VERSION)
+	{
+		std::cout << "QuadtreeSnapshot -> " << path << " has format version " << header->version << " (expected " << QUADTREE_SNAPSHOT_VERSION << ")" << std::endl;
+		close();
+		return false;
+	}
+
+	bool points = (header->flags & QUADTREE_SNAPSHOT_POINTS) != 0;
+
+	if ((header->payloadSize != mappingSize - sizeof(QuadtreeSnapshotHeader)) or (header->payloadSize != payload_size(header->amtNodes, header->amtEntries, header->amtPoints, points)) or (header->amtNodes == 0))
+	{
+		std::cout << "QuadtreeSnapshot -> " << path << " is truncated" << std::endl;
+		close();
+		return false;
+	}
+
+	const char *payload = static_cast<const char *>(mapping) + sizeof(QuadtreeSnapshotHeader);
+
+	if (verifyChecksum and (quadtree_snapshot_checksum(payload, header->payloadSize) != header->checksum))
+	{
+		std::cout << "QuadtreeSnapshot -> checksum mismatch of " << path << std::endl;
+		close();
+		return false;
+	}
+
+	nodes = reinterpret_cast<const QuadtreeSnapshotNode *>(payload);
+	entryStart = reinterpret_cast<const int32_t *>(nodes + header->amtNodes);
+	entryAmount = entryStart + header->amtEntries;
+
+	if (points)
+	{
+		pointsX = reinterpret_cast<const float *>(entryAmount + header->amtEntries);
+		pointsY = pointsX + header->amtPoints;
+	}
+	else if ((iVecX != nullptr) and (iVecY != nullptr) and (iVecX->size() >= header->amtPoints) and (iVecY->size() >= header->amtPoints))
+	{
+		pointsX = iVecX->data();
+		pointsY = iVecY->data();
+	}
+	else
+	{
+		std::cout << "QuadtreeSnapshot -> " << path << " contains no points, the point vectors have to be provided" << std::endl;
+		close();
+		return false;
+	}
+
+	if (validate() == false)
+	{
+		std::cout << "QuadtreeSnapshot -> " << path << " is corrupt" << std::endl;
+		close();
+		return false;
+	}
+
+	return true;
+}
+
+void QuadtreeSnapshot::close()
+{
+	if (mapping != nullptr)
+	{
+		munmap(mapping, mappingSize);
+	}
+
+	mapping = nullptr;
+	mappingSize = 0;
+
+	header = nullptr;
+	nodes = nullptr;
+	entryStart = nullptr;
+	entryAmount = nullptr;
+	pointsX = nullptr;
+	pointsY = nullptr;
+}
+
+// the queries rely on valid indices -> check them once (even if the checksum is not verified)
+bool QuadtreeSnapshot::validate() const
+{
+	uint32_t amtNodes = header->amtNodes;
+
+	for (uint32_t i = 0; i < amtNodes; i++)
+	{
+		const QuadtreeSnapshotNode &node = nodes[i];
+
+		// children are stored behind their parent node (64 bit: amtNodes < 4 must not wrap around)
+		if ((node.firstChild != 0) and ((node.firstChild <= i) or ((uint64_t)node.firstChild + 4 > amtNodes)))
+		{
+			return false;
+		}
+
+		if ((node.elementBegin > node.sharedBegin) or (node.sharedBegin > node.elementEnd) or (node.elementEnd > header->amtEntries))
+		{
+			return false;
+		}
+	}
+
+	for (uint32_t i = 0; i < header->amtEntries; i++)
+	{
+		if ((entryStart[i] < 0) or (entryAmount[i] < 1) or ((uint64_t)entryStart[i] + entryAmount[i] > header->amtPoints))
+		{
+			return false;
+		}
+	}
+
+	return true;
+}
+
+void QuadtreeSnapshot::next_query_epoch()
+{
+	if (stamp.size() < header->amtPoints)
+	{
+		stamp.resize(header->amtPoints, epoch);
+	}
+
+	epoch++;
+
+	// overflow of the epoch -> reset all stamps
+	if (epoch == 0)
+	{
+		std::fill(stamp.begin(), stamp.end(), 0);
+		epoch = 1;
+	}
+}
+
+// elements of the leaf nodes overlapping the box (touching: a node touching the box counts, nodes inside the box are reported without further tests)
+void QuadtreeSnapshot::query_internal(uint32_t node, float xmin, float xmax, float ymin, float ymax, bool touching, std::vector< std::pair<int, int> > &vec)
+{
+	const QuadtreeSnapshotNode &t = nodes[node];
+
+	float bxmin = t.cx-t.dim;
+	float bxmax = t.cx+t.dim;
+	float bymin = t.cy-t.dim;
+	float bymax = t.cy+t.dim;
+
+	// no collision
+	if (touching)
+	{
+		if ((xmax < bxmin) or (xmin > bxmax) or (ymax < bymin) or (ymin > bymax))
+		{
+			return;
+		}
+
+		if ((xmin <= bxmin) and (xmax >= bxmax) and (ymin <= bymin) and (ymax >= bymax))
+		{
+			report_subtree(node, vec);
+			return;
+		}
+	}
+	// same test as Quadtree (an element of zero width or height overlaps the node (bxmin, bxmax], see BoundaryBox::overlaps)
+	else if ((BoundaryBox::overlaps_interval(xmin, xmax, bxmin, bxmax) == false) or (BoundaryBox::overlaps_interval(ymin, ymax, bymin, bymax) == false))
+	{
+		return;
+	}
+
+	if (t.firstChild != 0)
+	{
+		// same order as Quadtree (NE, NW, SE, SW)
+		query_internal(t.firstChild+1, xmin, xmax, ymin, ymax, touching, vec);
+		query_internal(t.firstChild, xmin, xmax, ymin, ymax, touching, vec);
+		query_internal(t.firstChild+3, xmin, xmax, ymin, ymax, touching, vec);
+		query_internal(t.firstChild+2, xmin, xmax, ymin, ymax, touching, vec);
+		return;
+	}
+
+	report_subtree(node, vec);
+}
+
+void QuadtreeSnapshot::report_subtree(uint32_t node, std::vector< std::pair<int, int> > &vec)
+{
+	const QuadtreeSnapshotNode &t = nodes[node];
+
+	if (t.firstChild != 0)
+	{
+		report_subtree(t.firstChild+1, vec);
+		report_subtree(t.firstChild, vec);
+		report_subtree(t.firstChild+3, vec);
+		report_subtree(t.firstChild+2, vec);
+		return;
+	}
+
+	for (uint32_t i = t.elementBegin; i < t.sharedBegin; i++)
+	{
+		vec.push_back(std::make_pair(entryStart[i], entryAmount[i]));
+	}
+
+	// shared elements reside in several leaf nodes -> report them only once per query
+	for (uint32_t i = t.sharedBegin; i < t.elementEnd; i++)
+	{
+		if (stamp[entryStart[i]] != epoch)
+		{
+			stamp[entryStart[i]] = epoch;
+			vec.push_back(std::make_pair(entryStart[i], entryAmount[i]));
+		}
+	}
+}
+
+void QuadtreeSnapshot::fetch_elements(int iStart, int iAmount, std::vector< std::pair<int, int> > &vec)
+{
+	float xmin, xmax, ymin, ymax;
+	points_AABB(pointsX+iStart, pointsY+iStart, iAmount, xmin, xmax, ymin, ymax);
+
+	next_query_epoch();
+	query_internal(0, xmin, xmax, ymin, ymax, false, vec);
+}
+
+void QuadtreeSnapshot::query_aabb(float xmin, float xmax, float ymin, float ymax, std::vector< std::pair<int, int> > &vec)
+{
+	next_query_epoch();
+	query_internal(0, xmin, xmax, ymin, ymax, true, vec);
+}
+
+int QuadtreeSnapshot::count_nodes() const
+{
+	int leafNodes = 0;
+
+	for (uint32_t i = 0; i < header->amtNodes; i++)
+	{
+		if (nodes[i].firstChild == 0)
+		{
+			leafNodes++;
+		}
+	}
+
+	return leafNodes;
+}
+
+
+// write the tree (and the points if includePoints) into a snapshot file
+template <typename Scalar>
+bool BasicQuadtree<Scalar>::save_snapshot(const std::string &path, bool includePoints) const
+{
+	static_assert(std::is_same<Scalar, float>::value, "snapshots store float coordinates");
+
+	if (this != this->parent)
+	{
+		std::cout << "save_snapshot -> has to be called on the root node" << std::endl;
+		return false;
+	}
+
+	if (single_node_storage() or storageSettings->exactOverlap)
+	{
+		std::cout << "save_snapshot -> snapshots are only available for the shared storage without exact overlap tests" << std::endl;
+		return false;
+	}
+
+	// nodes in breadth first order (the four children of a node are stored consecutively)
+	std::vector<const BasicQuadtree *> order(1, this);
+	std::vector<QuadtreeSnapshotNode> snapshotNodes;
+	std::vector<int32_t> snapshotStart;
+	std::vector<int32_t> snapshotAmount;
+
+	for (std::size_t i = 0; i < order.size(); i++)
+	{
+		const BasicQuadtree *t = order[i];
+
+		QuadtreeSnapshotNode node;
+		node.cx = t->boundary2.cx;
+		node.cy = t->boundary2.cy;
+		node.dim = t->boundary2.dim;
+		node.depth = t->nodeDepth;
+		node.firstChild = 0;
+
+		if (t->northWest != nullptr)	// this node has been split yet -> != nullptr
+		{
+			node.firstChild = order.size();
+
+			order.push_back(t->northWest);
+			order.push_back(t->northEast);
+			order.push_back(t->southWest);
+			order.push_back(t->southEast);
+		}
+
+		node.elementBegin = snapshotStart.size();
+		snapshotStart.insert(snapshotStart.end(), t->element_start.begin(), t->element_start.end());
+		snapshotAmount.insert(snapshotAmount.end(), t->element_amount.begin(), t->element_amount.end());
+
+		node.sharedBegin = snapshotStart.size();
+		snapshotStart.insert(snapshotStart.end(), t->shared_element_start.begin(), t->shared_element_start.end());
+		snapshotAmount.insert(snapshotAmount.end(), t->shared_element_amount.begin(), t->shared_element_amount.end());
+
+		node.elementEnd = snapshotStart.size();
+
+		snapshotNodes.push_back(node);
+	}
+
+	QuadtreeSnapshotHeader header;
+	std::memset(&header, 0, sizeof(header));
+	std::memcpy(header.magic, snapshotMagic, sizeof(snapshotMagic));
+
+	header.version = QUADTREE_SNAPSHOT_VERSION;
+	header.byteOrder = snapshotByteOrder;
+	header.flags = includePoints ? QUADTREE_SNAPSHOT_POINTS : 0;
+	header.maxAmtElements = maxAmtElements;
+	header.maxDepth = maxDepth;
+	header.cx = boundary2.cx;
+	header.cy = boundary2.cy;
+	header.dim = boundary2.dim;
+	header.amtNodes = snapshotNodes.size();
+	header.amtEntries = snapshotStart.size();
+	header.amtPoints = ptrToX->size();
+	header.payloadSize = payload_size(header.amtNodes, header.amtEntries, header.amtPoints, includePoints);
+
+	// sections of the payload
+	std::vector< std::pair<const void *, std::size_t> > sections;
+	sections.push_back(std::make_pair(snapshotNodes.data(), snapshotNodes.size()*sizeof(QuadtreeSnapshotNode)));
+	sections.push_back(std::make_pair(snapshotStart.data(), snapshotStart.size()*sizeof(int32_t)));
+	sections.push_back(std::make_pair(snapshotAmount.data(), snapshotAmount.size()*sizeof(int32_t)));
+
+	if (includePoints)
+	{
+		sections.push_back(std::make_pair(ptrToX->data(), ptrToX->size()*sizeof(float)));
+		sections.push_back(std::make_pair(ptrToY->data(), ptrToY->size()*sizeof(float)));
+	}
+
+	header.checksum = quadtree_snapshot_checksum(nullptr, 0);
+
+	for (auto &section : sections)
+	{
+		header.checksum = quadtree_snapshot_checksum(section.first, section.second, header.checksum);
+	}
+
+	std::ofstream file(path, std::ios::binary | std::ios::trunc);
+
+	file.write(reinterpret_cast<const char *>(&header), sizeof(header));
+
+	for (auto &section : sections)
+	{
+		file.write(static_cast<const char *>(section.first), section.second);
+	}
+
+	file.close();
+
+	if (file.fail())
+	{
+		std::cout << "save_snapshot -> cannot write " << path << std::endl;
+		return false;
+	}
+
+	return true;
+}
+
+// replace the tree by the tree stored in the snapshot (single pass over the nodes)
+template <typename Scalar>
+bool BasicQuadtree<Scalar>::load_snapshot(const QuadtreeSnapshot &snapshot)
+{
+	static_assert(std::is_same<Scalar, float>::value, "snapshots store float coordinates");
+
+	if (this != this->parent)
+	{
+		std::cout << "load_snapshot -> has to be called on the root node" << std::endl;
+		return false;
+	}
+
+	if (single_node_storage() or storageSettings->exactOverlap)
+	{
+		std::cout << "load_snapshot -> snapshots are only available for the shared storage without exact overlap tests" << std::endl;
+		return false;
+	}
+
+	if (snapshot.is_open() == false)
+	{
+		std::cout << "load_snapshot -> snapshot is not open" << std::endl;
+		return false;
+	}
+
+	const QuadtreeSnapshotHeader &info = snapshot.info();
+
+	if ((info.maxAmtElements != maxAmtElements) or (info.maxDepth != maxDepth) or (info.cx != boundary2.cx) or (info.cy != boundary2.cy) or (info.dim != boundary2.dim))
+	{
+		std::cout << "load_snapshot -> boundary box, split threshold or maximum depth of the snapshot differ from the tree" << std::endl;
+		return false;
+	}
+
+	// points stored in the snapshot replace the points of the tree
+	if (snapshot.has_points())
+	{
+		ptrToX->assign(snapshot.points_x(), snapshot.points_x() + info.amtPoints);
+		ptrToY->assign(snapshot.points_y(), snapshot.points_y() + info.amtPoints);
+	}
+	else if ((ptrToX->size() < info.amtPoints) or (ptrToY->size() < info.amtPoints))
+	{
+		std::cout << "load_snapshot -> the snapshot references more points than the tree holds" << std::endl;
+		return false;
+	}
+
+	versions->elements++;
+
+	// start from an empty tree
+	clearNode();
+
+	if (elementIndex != nullptr)
+	{
+		elementIndex->clear();
+	}
+
+	element_start.clear();
+	element_amount.clear();
+	shared_element_start.clear();
+	shared_element_amount.clear();
+
+	const QuadtreeSnapshotNode *nodes = snapshot.node_array();
+	const int32_t *entryStart = snapshot.entry_start();
+	const int32_t *entryAmount = snapshot.entry_amount();
+
+	// node of the tree corresponding to every node of the snapshot (the children are created when their parent node is reached)
+	std::vector<BasicQuadtree *> treeNodes(info.amtNodes, nullptr);
+	treeNodes[0] = this;
+
+	// shared elements reside in several nodes -> refresh their AABB only once
+	std::vector<char> refreshed(info.amtPoints, 0);
+
+	for (uint32_t i = 0; i < info.amtNodes; i++)
+	{
+		BasicQuadtree *t = treeNodes[i];
+
+		if ((t == nullptr) or (t->nodeDepth != nodes[i].depth) or (t->boundary2.cx != nodes[i].cx) or (t->boundary2.cy != nodes[i].cy) or (t->boundary2.dim != nodes[i].dim))
+		{
+			std::cout << "load_snapshot -> node hierarchy of the snapshot is corrupt" << std::endl;
+			clearNode();
+			return false;
+		}
+
+		if (nodes[i].firstChild != 0)
+		{
+			if (t->subdivide() == false)
+			{
+				std::cout << "load_snapshot -> node hierarchy of the snapshot is corrupt" << std::endl;
+				clearNode();
+				return false;
+			}
+
+			treeNodes[nodes[i].firstChild] = t->northWest;
+			treeNodes[nodes[i].firstChild+1] = t->northEast;
+			treeNodes[nodes[i].firstChild+2] = t->southWest;
+			treeNodes[nodes[i].firstChild+3] = t->southEast;
+		}
+
+		for (uint32_t k = nodes[i].elementBegin; k < nodes[i].elementEnd; k++)
+		{
+			bool shared = (k >= nodes[i].sharedBegin);
+
+			push_element(t, entryStart[k], entryAmount[k], shared);
+
+			if (refreshed[entryStart[k]] == 0)
+			{
+				refreshed[entryStart[k]] = 1;
+				refresh_AABB(entryStart[k], entryAmount[k]);
+			}
+		}
+	}
+
+	return true;
+}
+
+// snapshots are only available for float coordinates (Quadtree)
+template bool BasicQuadtree<float>::save_snapshot(const std::string &path, bool includePoints) const;
+template bool BasicQuadtree<float>::load_snapshot(const QuadtreeSnapshot &snapshot);
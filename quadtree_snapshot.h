@@ -0,0 +1,124 @@
+// binary snapshot of a quadtree (save, memory mapped read-only queries, load into a Quadtree)
+#ifndef __QUADTREE_SNAPSHOT_H_INCLUDED__
+#define __QUADTREE_SNAPSHOT_H_INCLUDED__
+
+#include <vector>
+#include <string>
+#include <cstdint>
+#include <cstddef>	// std::size_t
+#include <utility>	// std::pair
+
+// Layout of a snapshot file (native byte order, see Quadtree::save_snapshot):
+//	QuadtreeSnapshotHeader
+//	QuadtreeSnapshotNode nodes[amtNodes]	(breadth first, the four children of a node are stored consecutively: NW, NE, SW, SE)
+//	int32_t entryStart[amtEntries]			(elements of all nodes, contiguous per node)
+//	int32_t entryAmount[amtEntries]
+//	float x[amtPoints], float y[amtPoints]	(only if flags & QUADTREE_SNAPSHOT_POINTS)
+// The checksum covers everything behind the header. Snapshots of another format version (or byte order) are rejected.
+
+#define QUADTREE_SNAPSHOT_VERSION 1
+#define QUADTREE_SNAPSHOT_POINTS 0x1
+
+struct QuadtreeSnapshotHeader
+{
+	char magic[8];				// "QTSNAP\0\0"
+	uint32_t version;			// QUADTREE_SNAPSHOT_VERSION
+	uint32_t byteOrder;			// 0x01020304 written in the byte order of the writer
+	uint32_t flags;
+	uint32_t maxAmtElements;	// split threshold and maximum depth of the tree
+	int32_t maxDepth;
+	float cx, cy, dim;			// boundary box of the root node
+	uint32_t amtNodes;
+	uint32_t amtEntries;
+	uint32_t amtPoints;			// size of the point vectors of the tree (all iStart + iAmount <= amtPoints)
+	uint64_t payloadSize;		// size of the file behind the header
+	uint64_t checksum;			// FNV-1a (64 bit) of the payload
+};
+
+struct QuadtreeSnapshotNode
+{
+	float cx, cy, dim;			// boundary box of the node
+	int32_t depth;
+	uint32_t firstChild;		// index of the first children node (0 -> leaf node)
+	uint32_t elementBegin;		// elements residing completely in this node: entries [elementBegin, sharedBegin)
+	uint32_t sharedBegin;		// elements in the shared space of this node: entries [sharedBegin, elementEnd)
+	uint32_t elementEnd;
+};
+
+static_assert(sizeof(QuadtreeSnapshotHeader) % 8 == 0, "snapshot header has to keep the payload aligned");
+static_assert(sizeof(QuadtreeSnapshotNode) == 32, "unexpected padding of the snapshot nodes");
+
+// FNV-1a (64 bit) hash of a block of memory (hash: hash of the preceding blocks)
+uint64_t quadtree_snapshot_checksum(const void *data, std::size_t size, uint64_t hash = 14695981039346656037ULL);
+
+// Snapshot file mapped into memory (mmap). The tree can be queried in place (read-only, no copy of the nodes or elements) or copied into a Quadtree (Quadtree::load_snapshot).
+class QuadtreeSnapshot
+{
+	private:
+		// mapping of the file
+		void *mapping;
+		std::size_t mappingSize;
+
+		// sections of the file
+		const QuadtreeSnapshotHeader *header;
+		const QuadtreeSnapshotNode *nodes;
+		const int32_t *entryStart;
+		const int32_t *entryAmount;
+
+		// points of the elements (stored in the snapshot or provided by open())
+		const float *pointsX;
+		const float *pointsY;
+
+		// per-query stamps of the elements (see Quadtree::QueryScratch)
+		std::vector<unsigned int> stamp;
+		unsigned int epoch;
+
+		// start a new query
+		void next_query_epoch();
+
+		// auxiliary functions used by the queries (node: index of the node)
+		void query_internal(uint32_t node, float xmin, float xmax, float ymin, float ymax, bool touching, std::vector< std::pair<int,int> > &vec);
+		void report_subtree(uint32_t node, std::vector< std::pair<int,int> > &vec);
+
+		// check the counts and indices of the mapped file
+		bool validate() const;
+
+	public:
+		// constructor
+		QuadtreeSnapshot();
+
+		// destructor (unmaps the file)
+		~QuadtreeSnapshot();
+
+		QuadtreeSnapshot(const QuadtreeSnapshot &) = delete;
+		QuadtreeSnapshot &operator=(const QuadtreeSnapshot &) = delete;
+
+		// Map a snapshot file (read-only). The points are taken from the snapshot if it contains them, otherwise from iVecX and iVecY (which have to stay valid while the snapshot is open). Returns false (and prints the reason) if the file cannot be read, is of another format version or is corrupt (verifyChecksum: hash the whole file, the counts and indices are always checked).
+		bool open(const std::string &path, const std::vector<float> *iVecX = nullptr, const std::vector<float> *iVecY = nullptr, bool verifyChecksum = true);
+
+		// unmap the file
+		void close();
+
+		bool is_open() const { return mapping != nullptr; }
+
+		// read-only access to the sections of the file
+		const QuadtreeSnapshotHeader &info() const { return *header; }
+		const QuadtreeSnapshotNode *node_array() const { return nodes; }
+		const int32_t *entry_start() const { return entryStart; }
+		const int32_t *entry_amount() const { return entryAmount; }
+		const float *points_x() const { return pointsX; }
+		const float *points_y() const { return pointsY; }
+
+		// true if the points are stored in the snapshot
+		bool has_points() const { return (header->flags & QUADTREE_SNAPSHOT_POINTS) != 0; }
+
+		// same as Quadtree::fetch_elements(iStart, iAmount, vec)
+		void fetch_elements(int iStart, int iAmount, std::vector< std::pair<int,int> > &vec);
+
+		// same as Quadtree::query_aabb(xmin, xmax, ymin, ymax, vec)
+		void query_aabb(float xmin, float xmax, float ymin, float ymax, std::vector< std::pair<int,int> > &vec);
+
+		// count the leaf nodes
+		int count_nodes() const;
+};
+#endif
@@ -0,0 +1,224 @@
+// operation counters and latency histograms of the quadtree
+#ifndef __QUADTREE_STATS_H_INCLUDED__
+#define __QUADTREE_STATS_H_INCLUDED__
+
+#include <atomic>
+#include <algorithm>	// std::min
+#include <chrono>
+#include <cstdint>
+
+// The counters are only maintained if QUADTREE_STATS is defined at compile time (e.g., -DQUADTREE_STATS). Otherwise all instrumentation compiles to nothing and Quadtree::stats() returns zeros.
+
+// public calls whose duration is measured
+enum QuadtreeOperation
+{
+	QUADTREE_OP_INSERT,
+	QUADTREE_OP_BUILD,
+	QUADTREE_OP_DELETE,
+	QUADTREE_OP_RELOCATE,
+	QUADTREE_OP_FETCH,			// fetch_elements(), visit_elements()
+	QUADTREE_OP_FETCH_BATCH,
+	QUADTREE_OP_CANDIDATE_PAIRS,
+	QUADTREE_OP_NEAREST,
+	QUADTREE_OP_REGION,			// query_aabb(), query_circle(), query_polygon()
+	QUADTREE_OP_RAYCAST,		// raycast(), segment_query()
+	QUADTREE_OP_COUNT
+};
+
+// name of an operation (e.g. for printing the statistics)
+inline const char *quadtree_operation_name(int operation)
+{
+	static const char *names[QUADTREE_OP_COUNT] = {"insert", "build", "delete_element", "relocate_element", "fetch_elements", "fetch_elements_batch", "collect_candidate_pairs", "fetch_nearest_elements", "query_region", "raycast"};
+
+	return ((operation >= 0) and (operation < QUADTREE_OP_COUNT)) ? names[operation] : "unknown";
+}
+
+// durations of the calls of a single operation
+struct QuadtreeTiming
+{
+	// bucket i counts the calls lasting [2^i, 2^(i+1)) ns (bucket 0 also counts calls of 0 ns, the last bucket all longer calls)
+	static const int amtBuckets = 40;
+
+	uint64_t calls = 0;
+	uint64_t totalNanoseconds = 0;
+	uint64_t maxNanoseconds = 0;
+	uint64_t histogram[amtBuckets] = {};
+
+	// upper bound of the duration (in ns) of the fraction q (0...1) of the fastest calls (resolution: the buckets of the histogram)
+	uint64_t percentile(double q) const
+	{
+		uint64_t rank = (uint64_t)(q*calls);
+		uint64_t cumulative = 0;
+
+		for (int i = 0; i < amtBuckets; i++)
+		{
+			cumulative += histogram[i];
+
+			if ((cumulative > rank) or (cumulative == calls))
+			{
+				return (i == amtBuckets-1) ? maxNanoseconds : std::min(maxNanoseconds, ((uint64_t)2 << i) - 1);
+			}
+		}
+
+		return maxNanoseconds;
+	}
+};
+
+// snapshot of the statistics of a tree (see Quadtree::stats())
+struct QuadtreeStats
+{
+	uint64_t queries = 0;				// fetch_elements() / visit_elements() / fetch_nearest_elements() / region query / raycast() calls and queries of fetch_elements_batch()
+	uint64_t nodeVisits = 0;			// nodes visited by these queries
+	uint64_t subdivisions = 0;			// subdivide() calls splitting a node
+	uint64_t merges = 0;				// four leaf nodes merged into their parent by concatenate_nodes()
+	uint64_t sharedInserts = 0;			// elements added to the shared space of a leaf node by test2()
+	uint64_t removeScans = 0;			// linear searches of an element in the shared space of a leaf node (recursive_remove(), recursive_removeAABB())
+	uint64_t removeScanLength = 0;		// elements compared by these searches
+
+	QuadtreeTiming timing[QUADTREE_OP_COUNT];
+};
+
+#ifdef QUADTREE_STATS
+// Counters of a tree (owned by the root node). Relaxed atomics, because the queries of fetch_elements_batch() and the subtrees of a parallel build() run on several threads.
+struct QuadtreeStatsCounters
+{
+	typedef std::atomic<uint64_t> Counter;
+
+	Counter queries{0};
+	Counter nodeVisits{0};
+	Counter subdivisions{0};
+	Counter merges{0};
+	Counter sharedInserts{0};
+	Counter removeScans{0};
+	Counter removeScanLength{0};
+
+	struct Timing
+	{
+		Counter calls{0};
+		Counter totalNanoseconds{0};
+		Counter maxNanoseconds{0};
+		Counter histogram[QuadtreeTiming::amtBuckets] = {};
+	};
+
+	Timing timing[QUADTREE_OP_COUNT];
+
+	// depth of the measured public calls (calls made by other public calls, e.g., relocate_element() -> insert(), are not measured separately)
+	int nesting = 0;
+
+	void record(int operation, uint64_t nanoseconds)
+	{
+		Timing &t = timing[operation];
+
+		int bucket = 0;
+
+		while ((bucket < QuadtreeTiming::amtBuckets-1) and ((nanoseconds >> (bucket+1)) != 0))
+		{
+			bucket++;
+		}
+
+		t.calls.fetch_add(1, std::memory_order_relaxed);
+		t.totalNanoseconds.fetch_add(nanoseconds, std::memory_order_relaxed);
+		t.histogram[bucket].fetch_add(1, std::memory_order_relaxed);
+
+		uint64_t previousMax = t.maxNanoseconds.load(std::memory_order_relaxed);
+
+		while ((nanoseconds > previousMax) and (t.maxNanoseconds.compare_exchange_weak(previousMax, nanoseconds, std::memory_order_relaxed) == false))
+		{
+		}
+	}
+
+	QuadtreeStats snapshot() const
+	{
+		QuadtreeStats s;
+
+		s.queries = queries.load(std::memory_order_relaxed);
+		s.nodeVisits = nodeVisits.load(std::memory_order_relaxed);
+		s.subdivisions = subdivisions.load(std::memory_order_relaxed);
+		s.merges = merges.load(std::memory_order_relaxed);
+		s.sharedInserts = sharedInserts.load(std::memory_order_relaxed);
+		s.removeScans = removeScans.load(std::memory_order_relaxed);
+		s.removeScanLength = removeScanLength.load(std::memory_order_relaxed);
+
+		for (int op = 0; op < QUADTREE_OP_COUNT; op++)
+		{
+			s.timing[op].calls = timing[op].calls.load(std::memory_order_relaxed);
+			s.timing[op].totalNanoseconds = timing[op].totalNanoseconds.load(std::memory_order_relaxed);
+			s.timing[op].maxNanoseconds = timing[op].maxNanoseconds.load(std::memory_order_relaxed);
+
+			for (int i = 0; i < QuadtreeTiming::amtBuckets; i++)
+			{
+				s.timing[op].histogram[i] = timing[op].histogram[i].load(std::memory_order_relaxed);
+			}
+		}
+
+		return s;
+	}
+
+	void reset()
+	{
+		Counter *counters[] = {&queries, &nodeVisits, &subdivisions, &merges, &sharedInserts, &removeScans, &removeScanLength};
+
+		for (Counter *counter : counters)
+		{
+			counter->store(0, std::memory_order_relaxed);
+		}
+
+		for (int op = 0; op < QUADTREE_OP_COUNT; op++)
+		{
+			timing[op].calls.store(0, std::memory_order_relaxed);
+			timing[op].totalNanoseconds.store(0, std::memory_order_relaxed);
+			timing[op].maxNanoseconds.store(0, std::memory_order_relaxed);
+
+			for (int i = 0; i < QuadtreeTiming::amtBuckets; i++)
+			{
+				timing[op].histogram[i].store(0, std::memory_order_relaxed);
+			}
+		}
+	}
+};
+
+// measures the duration of the enclosing public call (only the outermost one)
+class QuadtreeStatsTimer
+{
+	private:
+		QuadtreeStatsCounters *counters;
+		int operation;
+		bool outermost;
+		std::chrono::steady_clock::time_point start;
+
+	public:
+		QuadtreeStatsTimer(QuadtreeStatsCounters *_counters, int _operation)
+		{
+			counters = _counters;
+			operation = _operation;
+			outermost = (counters->nesting++ == 0);
+
+			if (outermost)
+			{
+				start = std::chrono::steady_clock::now();
+			}
+		}
+
+		~QuadtreeStatsTimer()
+		{
+			if (outermost)
+			{
+				counters->record(operation, std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now() - start).count());
+			}
+
+			counters->nesting--;
+		}
+};
+
+// QUADTREE_STATS_ADD(counter, value): add value to a counter of the tree (used inside the member functions of Quadtree)
+// QUADTREE_STATS_TIMER(operation): measure the duration of the enclosing public call
+// QUADTREE_STATS_ONLY(statement): statement only compiled if the statistics are enabled
+#define QUADTREE_STATS_ADD(counter, value) statsCounters->counter.fetch_add((value), std::memory_order_relaxed)
+#define QUADTREE_STATS_TIMER(operation) QuadtreeStatsTimer quadtreeStatsTimer(statsCounters, (operation))
+#define QUADTREE_STATS_ONLY(statement) statement
+#else
+#define QUADTREE_STATS_ADD(counter, value) ((void)0)
+#define QUADTREE_STATS_TIMER(operation) ((void)0)
+#define QUADTREE_STATS_ONLY(statement)
+#endif
+#endif
@@ -0,0 +1,350 @@
+// tests of the snapshots: round trip (save, query in place, load) and corrupt files (run by ctest in the build directory)
+#include <iostream>
+#include <fstream>
+#include <iterator>
+#include <random>
+#include <algorithm>
+#include <memory>
+#include <string>
+#include <vector>
+#include <set>
+#include <cstring>
+#include <cstddef>	// offsetof
+
+#include "quadtree.h"
+#include "quadtree_snapshot.h"
+
+namespace
+{
+	int failures = 0;
+
+	// split threshold and maximum depth of the trees (fixed at compile time: the arguments of the constructor are ignored, see QUADTREE_MAX_ELEMENTS)
+#ifdef QUADTREE_FIXED_CONFIG
+	const unsigned int maxElements = QUADTREE_MAX_ELEMENTS;
+	const int maxDepth = QUADTREE_MAX_DEPTH;
+#else
+	const unsigned int maxElements = 4;
+	const int maxDepth = 8;
+#endif
+
+	void fail(const std::string &test, const std::string &message)
+	{
+		std::cout << test << " -> " << message << std::endl;
+		failures++;
+	}
+
+	std::vector<char> read_file(const std::string &path)
+	{
+		std::ifstream file(path, std::ios::binary);
+
+		return std::vector<char>(std::istreambuf_iterator<char>(file), std::istreambuf_iterator<char>());
+	}
+
+	void write_file(const std::string &path, const std::vector<char> &bytes)
+	{
+		std::ofstream file(path, std::ios::binary | std::ios::trunc);
+		file.write(bytes.data(), bytes.size());
+	}
+
+	// random elements (segments and triangles) in the root node [-1000, 1000]^2
+	void generate(int amtElements, std::vector<float> &x, std::vector<float> &y, std::vector< std::pair<int, int> > &elements)
+	{
+		std::mt19937 rng(7);
+		std::uniform_real_distribution<float> center(-980, 980);
+		std::uniform_real_distribution<float> offset(-20, 20);
+
+		for (int i = 0; i < amtElements; i++)
+		{
+			int amount = 2 + i % 2;
+			float cx = center(rng);
+			float cy = center(rng);
+
+			elements.push_back(std::make_pair((int)x.size(), amount));
+
+			for (int k = 0; k < amount; k++)
+			{
+				x.push_back(cx + offset(rng));
+				y.push_back(cy + offset(rng));
+			}
+		}
+	}
+
+	std::set< std::pair<int, int> > as_set(const std::vector< std::pair<int, int> > &vec)
+	{
+		return std::set< std::pair<int, int> >(vec.begin(), vec.end());
+	}
+
+	// save, query in place and load (with and without the points in the snapshot)
+	void test_round_trip(bool includePoints)
+	{
+		std::string test = includePoints ? "round trip (points)" : "round trip (no points)";
+		std::string path = "quadtree_snapshot_test.qts";
+
+		std::vector<float> x, y;
+		std::vector< std::pair<int, int> > elements;
+		generate(2000, x, y, elements);
+
+		Quadtree tree(std::make_shared<Quadtree::Box>(0, 0, 1024), nullptr, 0, &x, &y, maxElements, maxDepth);
+
+		for (const auto &element : elements)
+		{
+			tree.insert(element.first, element.second);
+		}
+
+		// deleted elements must not show up in the snapshot
+		for (int i = 0; i < (int)elements.size(); i += 5)
+		{
+			tree.delete_element(elements[i].first, elements[i].second);
+		}
+
+		if (tree.save_snapshot(path, includePoints) == false)
+		{
+			fail(test, "save_snapshot failed");
+			return;
+		}
+
+		QuadtreeSnapshot snapshot;
+
+		if (snapshot.open(path, includePoints ? nullptr : &x, includePoints ? nullptr : &y) == false)
+		{
+			fail(test, "open failed");
+			return;
+		}
+
+		if (snapshot.count_nodes() != tree.count_nodes(&tree))
+		{
+			fail(test, "the amount of nodes differs");
+		}
+
+		std::mt19937 rng(11);
+		std::uniform_real_distribution<float> coordinate(-1000, 1000);
+		std::uniform_real_distribution<float> size(0, 150);
+
+		for (int q = 0; q < 200; q++)
+		{
+			float xmin = coordinate(rng);
+			float ymin = coordinate(rng);
+			float xmax = xmin + size(rng);
+			float ymax = ymin + size(rng);
+
+			std::vector< std::pair<int, int> > fromTree, fromSnapshot;
+			tree.query_aabb(xmin, xmax, ymin, ymax, fromTree);
+			snapshot.query_aabb(xmin, xmax, ymin, ymax, fromSnapshot);
+
+			if ((fromSnapshot.size() != as_set(fromSnapshot).size()) or (as_set(fromTree) != as_set(fromSnapshot)))
+			{
+				fail(test, "query_aabb of the snapshot differs from the tree");
+				return;
+			}
+		}
+
+		// load into a new tree
+		std::vector<float> loadX, loadY;
+		Quadtree loaded(std::make_shared<Quadtree::Box>(0, 0, 1024), nullptr, 0, &loadX, &loadY, maxElements, maxDepth);
+
+		if (includePoints)
+		{
+			loadX.assign(snapshot.points_x(), snapshot.points_x() + snapshot.info().amtPoints);
+			loadY.assign(snapshot.points_y(), snapshot.points_y() + snapshot.info().amtPoints);
+		}
+		else
+		{
+			loadX = x;
+			loadY = y;
+		}
+
+		if (loaded.load_snapshot(snapshot) == false)
+		{
+			fail(test, "load_snapshot failed");
+			return;
+		}
+
+		for (int i = 1; i < (int)elements.size(); i += 3)
+		{
+			if (i % 5 == 0)
+			{
+				continue;
+			}
+
+			std::vector< std::pair<int, int> > fromTree, fromSnapshot, fromLoaded;
+			tree.fetch_elements(elements[i].first, elements[i].second, fromTree);
+			snapshot.fetch_elements(elements[i].first, elements[i].second, fromSnapshot);
+			loaded.fetch_elements(elements[i].first, elements[i].second, fromLoaded);
+
+			if ((as_set(fromTree) != as_set(fromSnapshot)) or (as_set(fromTree) != as_set(fromLoaded)))
+			{
+				fail(test, "fetch_elements of the snapshot or the loaded tree differs from the tree");
+				return;
+			}
+		}
+	}
+
+	// open() has to reject the file (without crashing)
+	void expect_rejected(const std::string &test, const std::vector<char> &bytes, bool verifyChecksum)
+	{
+		std::string path = "quadtree_snapshot_test_corrupt.qts";
+		write_file(path, bytes);
+
+		QuadtreeSnapshot snapshot;
+
+		if (snapshot.open(path, nullptr, nullptr, verifyChecksum))
+		{
+			fail(test, "corrupt snapshot accepted");
+		}
+	}
+
+	// copy of bytes with the 32 bit field at offset replaced by value
+	std::vector<char> patched(const std::vector<char> &bytes, std::size_t offset, uint32_t value)
+	{
+		std::vector<char> result = bytes;
+		std::memcpy(result.data() + offset, &value, sizeof(value));
+
+		return result;
+	}
+
+	// snapshot whose node array or element lists point out of the file (the checksum is not verified, i.e., only validate() protects the queries)
+	void test_corrupt_indices()
+	{
+		std::string path = "quadtree_snapshot_test.qts";
+		const std::size_t headerSize = sizeof(QuadtreeSnapshotHeader);
+		const std::size_t firstChild = offsetof(QuadtreeSnapshotNode, firstChild);
+
+		std::vector<float> x, y;
+		std::vector< std::pair<int, int> > elements;
+
+		// single node (amtNodes < 4, the root node is not split): the bound of the children block must not wrap around
+		generate(std::min(2, (int)maxElements), x, y, elements);
+
+		Quadtree single(std::make_shared<Quadtree::Box>(0, 0, 1024), nullptr, 0, &x, &y, maxElements, maxDepth);
+
+		for (const auto &element : elements)
+		{
+			single.insert(element.first, element.second);
+		}
+
+		if (single.save_snapshot(path, true) == false)
+		{
+			fail("corrupt indices", "save_snapshot failed");
+			return;
+		}
+
+		std::vector<char> original = read_file(path);
+
+		expect_rejected("children of a single node", patched(original, headerSize + firstChild, 1), false);
+		expect_rejected("children of a single node (wrap around)", patched(original, headerSize + firstChild, 0xFFFFFFFF), false);
+
+		// split tree
+		x.clear();
+		y.clear();
+		elements.clear();
+		generate(300, x, y, elements);
+
+		Quadtree tree(std::make_shared<Quadtree::Box>(0, 0, 1024), nullptr, 0, &x, &y, maxElements, maxDepth);
+
+		for (const auto &element : elements)
+		{
+			tree.insert(element.first, element.second);
+		}
+
+		if (tree.save_snapshot(path, true) == false)
+		{
+			fail("corrupt indices", "save_snapshot failed");
+			return;
+		}
+
+		original = read_file(path);
+
+		QuadtreeSnapshotHeader header;
+		std::memcpy(&header, original.data(), headerSize);
+
+		const std::size_t lastNode = headerSize + (header.amtNodes-1)*sizeof(QuadtreeSnapshotNode);
+		const std::size_t entries = headerSize + header.amtNodes*sizeof(QuadtreeSnapshotNode);
+
+		expect_rejected("children before their parent", patched(original, lastNode + firstChild, 1), false);
+		expect_rejected("children behind the last node", patched(original, headerSize + firstChild, header.amtNodes-3), false);
+		expect_rejected("element list behind the last entry", patched(original, lastNode + offsetof(QuadtreeSnapshotNode, elementEnd), header.amtEntries+1), false);
+		expect_rejected("element behind the last point", patched(original, entries, header.amtPoints), false);
+		expect_rejected("negative element", patched(original, entries, 0xFFFFFFFF), false);
+		expect_rejected("element without points", patched(original, entries + header.amtEntries*sizeof(int32_t), 0), false);
+	}
+
+	// truncated and corrupted files
+	void test_corrupt_files()
+	{
+		std::string path = "quadtree_snapshot_test.qts";
+
+		std::vector<float> x, y;
+		std::vector< std::pair<int, int> > elements;
+		generate(300, x, y, elements);
+
+		Quadtree tree(std::make_shared<Quadtree::Box>(0, 0, 1024), nullptr, 0, &x, &y, maxElements, maxDepth);
+
+		for (const auto &element : elements)
+		{
+			tree.insert(element.first, element.second);
+		}
+
+		if (tree.save_snapshot(path, true) == false)
+		{
+			fail("corrupt files", "save_snapshot failed");
+			return;
+		}
+
+		const std::vector<char> original = read_file(path);
+		const std::size_t headerSize = sizeof(QuadtreeSnapshotHeader);
+
+		{
+			QuadtreeSnapshot snapshot;
+
+			if (snapshot.open(path) == false)
+			{
+				fail("corrupt files", "the unmodified snapshot is rejected");
+				return;
+			}
+		}
+
+		// empty file, truncated header, truncated payload
+		expect_rejected("empty file", std::vector<char>(), false);
+		expect_rejected("truncated header", std::vector<char>(original.begin(), original.begin() + headerSize/2), false);
+		expect_rejected("truncated payload", std::vector<char>(original.begin(), original.end() - 4), false);
+
+		// trailing garbage
+		std::vector<char> bytes = original;
+		bytes.resize(bytes.size() + 8, 0);
+		expect_rejected("trailing bytes", bytes, false);
+
+		// magic and version
+		bytes = original;
+		bytes[0] = 'X';
+		expect_rejected("magic", bytes, false);
+
+		bytes = original;
+		QuadtreeSnapshotHeader header;
+		std::memcpy(&header, bytes.data(), headerSize);
+		header.version = QUADTREE_SNAPSHOT_VERSION + 1;
+		std::memcpy(bytes.data(), &header, headerSize);
+		expect_rejected("version", bytes, false);
+
+		// a flipped bit of the payload is detected by the checksum
+		bytes = original;
+		bytes[headerSize + 5] ^= 0x10;
+		expect_rejected("checksum", bytes, true);
+	}
+}
+
+int main()
+{
+	test_round_trip(true);
+	test_round_trip(false);
+	test_corrupt_files();
+	test_corrupt_indices();
+
+	if (failures > 0)
+	{
+		std::cout << failures << " failed checks" << std::endl;
+		return 1;
+	}
+
+	std::cout << "all checks passed" << std::endl;
+	return 0;
+}
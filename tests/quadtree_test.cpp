@@ -0,0 +1,1107 @@
+// brute-force tests of the queries: the results of the tree are compared with a scan over all elements (run by ctest)
+#include <iostream>
+#include <random>
+#include <algorithm>
+#include <memory>
+#include <string>
+#include <vector>
+#include <set>
+#include <cmath>
+#include <type_traits>
+
+#include "quadtree.h"
+#include "linear_quadtree.h"
+
+namespace
+{
+	int failures = 0;
+
+	// split threshold and maximum depth of the trees (fixed at compile time: the arguments of the constructor are ignored, see QUADTREE_MAX_ELEMENTS)
+#ifdef QUADTREE_FIXED_CONFIG
+	const unsigned int maxElements = QUADTREE_MAX_ELEMENTS;
+	const int maxDepth = QUADTREE_MAX_DEPTH;
+#else
+	const unsigned int maxElements = 4;
+	const int maxDepth = 8;
+#endif
+
+	// tests of the splits of small trees need a split threshold of 1 (skipped if another one is fixed at compile time)
+	bool splits_single_elements(const std::string &test)
+	{
+#ifdef QUADTREE_FIXED_CONFIG
+		if ((QUADTREE_MAX_ELEMENTS != 1) or (QUADTREE_MAX_DEPTH < 1))
+		{
+			std::cout << test << " -> skipped (QUADTREE_MAX_ELEMENTS != 1)" << std::endl;
+			return false;
+		}
+#endif
+		(void)test;
+		return true;
+	}
+
+	// report a failed check (only the first few messages of a test run are printed)
+	void fail(const std::string &test, const std::string &message)
+	{
+		if (failures < 20)
+		{
+			std::cout << test << " -> " << message << std::endl;
+		}
+
+		failures++;
+	}
+
+	// The reference geometry is computed in double and does not share any code with the tree. Elements are closed polygons (2 points: segment, 1 point: point).
+	double orient(double ax, double ay, double bx, double by, double cx, double cy)
+	{
+		return (bx-ax)*(cy-ay) - (by-ay)*(cx-ax);
+	}
+
+	bool on_segment(double ax, double ay, double bx, double by, double px, double py)
+	{
+		return (std::min(ax, bx) <= px) and (px <= std::max(ax, bx)) and (std::min(ay, by) <= py) and (py <= std::max(ay, by));
+	}
+
+	bool segments_intersect(double ax, double ay, double bx, double by, double cx, double cy, double dx, double dy)
+	{
+		double o1 = orient(ax, ay, bx, by, cx, cy);
+		double o2 = orient(ax, ay, bx, by, dx, dy);
+		double o3 = orient(cx, cy, dx, dy, ax, ay);
+		double o4 = orient(cx, cy, dx, dy, bx, by);
+
+		if ((((o1 > 0) and (o2 < 0)) or ((o1 < 0) and (o2 > 0))) and (((o3 > 0) and (o4 < 0)) or ((o3 < 0) and (o4 > 0))))
+		{
+			return true;
+		}
+
+		return ((o1 == 0) and on_segment(ax, ay, bx, by, cx, cy)) or ((o2 == 0) and on_segment(ax, ay, bx, by, dx, dy)) or ((o3 == 0) and on_segment(cx, cy, dx, dy, ax, ay)) or ((o4 == 0) and on_segment(cx, cy, dx, dy, bx, by));
+	}
+
+	// closed polygon given by its vertices (double)
+	struct Shape
+	{
+		std::vector<double> x, y;
+	};
+
+	// point inside the polygon (even-odd rule, the boundary is covered by segments_intersect())
+	bool inside(const Shape &s, double px, double py)
+	{
+		bool in = false;
+
+		for (int i = 0, j = s.x.size()-1; i < (int)s.x.size(); j = i++)
+		{
+			if (((s.y[i] > py) != (s.y[j] > py)) and (px < (s.x[j]-s.x[i])*(py-s.y[i])/(s.y[j]-s.y[i]) + s.x[i]))
+			{
+				in = !in;
+			}
+		}
+
+		return (s.x.size() >= 3) and in;
+	}
+
+	bool shapes_overlap(const Shape &a, const Shape &b)
+	{
+		if (inside(a, b.x[0], b.y[0]) or inside(b, a.x[0], a.y[0]))
+		{
+			return true;
+		}
+
+		for (int i = 0, j = a.x.size()-1; i < (int)a.x.size(); j = i++)
+		{
+			for (int k = 0, l = b.x.size()-1; k < (int)b.x.size(); l = k++)
+			{
+				if (segments_intersect(a.x[j], a.y[j], a.x[i], a.y[i], b.x[l], b.y[l], b.x[k], b.y[k]))
+				{
+					return true;
+				}
+			}
+		}
+
+		return false;
+	}
+
+	Shape box_shape(double xmin, double xmax, double ymin, double ymax)
+	{
+		Shape s;
+		s.x = {xmin, xmax, xmax, xmin};
+		s.y = {ymin, ymin, ymax, ymax};
+
+		return s;
+	}
+
+	// distance from the point to the closed polygon (0 inside)
+	double distance_to_shape(const Shape &s, double px, double py)
+	{
+		if (inside(s, px, py))
+		{
+			return 0;
+		}
+
+		double best = INFINITY;
+
+		for (int i = 0, j = s.x.size()-1; i < (int)s.x.size(); j = i++)
+		{
+			double ex = s.x[i]-s.x[j];
+			double ey = s.y[i]-s.y[j];
+			double length2 = ex*ex + ey*ey;
+			double t = (length2 > 0) ? std::max(0.0, std::min(1.0, ((px-s.x[j])*ex + (py-s.y[j])*ey) / length2)) : 0;
+
+			best = std::min(best, std::hypot(s.x[j] + t*ex - px, s.y[j] + t*ey - py));
+		}
+
+		return best;
+	}
+
+	// the segment from (ax, ay) to (bx, by) touches the closed polygon
+	bool segment_hits_shape(const Shape &s, double ax, double ay, double bx, double by)
+	{
+		if (inside(s, ax, ay))
+		{
+			return true;
+		}
+
+		for (int i = 0, j = s.x.size()-1; i < (int)s.x.size(); j = i++)
+		{
+			if (segments_intersect(ax, ay, bx, by, s.x[j], s.y[j], s.x[i], s.y[i]))
+			{
+				return true;
+			}
+		}
+
+		return false;
+	}
+
+	// configuration of a test run
+	struct Config
+	{
+		std::string name;
+		QuadtreeStorage storage;
+		double looseness;
+		bool exactOverlap;
+		bool elementIndex;
+		bool deferred;
+		bool build;
+		bool nodePool;
+	};
+
+	// every element owns a slot of slotSize points in the point vectors
+	const int slotSize = 8;
+
+	template <typename Scalar>
+	class BruteForce
+	{
+		private:
+			typedef BasicQuadtree<Scalar> Tree;
+			typedef typename Tree::Real Real;
+
+			Config config;
+			std::string test;
+			std::mt19937 rng;
+
+			std::vector<Scalar> x, y;
+			std::vector< std::pair<int, int> > elements;
+			std::vector<char> live;
+
+			double uniform(double lo, double hi)
+			{
+				return std::uniform_real_distribution<double>(lo, hi)(rng);
+			}
+
+			Scalar coordinate(double v)
+			{
+				v = std::max(-1000.0, std::min(1000.0, v));
+
+				return std::is_integral<Scalar>::value ? (Scalar)std::lround(v) : (Scalar)v;
+			}
+
+			// amount of points of element i (points, segments, small and large polygons, long thin diagonals, concave stars)
+			int amount_points(int i) const
+			{
+				const int amount[6] = {1, 2, 3, 4, 4, 8};
+
+				return amount[i % 6];
+			}
+
+			// random shape of element i (all points inside the root node)
+			void generate(int i, Scalar *px, Scalar *py)
+			{
+				double cx = uniform(-950, 950);
+				double cy = uniform(-950, 950);
+				int amount = amount_points(i);
+
+				if (i % 6 == 4)
+				{
+					double length = uniform(100, 800);
+					double width = uniform(1, 8);
+					double direction = (rng() % 2) ? 1 : -1;
+					double vx[4] = {0, length, length+width, width};
+					double vy[4] = {0, direction*length, direction*(length-width), -direction*width};
+
+					for (int k = 0; k < 4; k++)
+					{
+						px[k] = coordinate(cx - length/2 + vx[k]);
+						py[k] = coordinate(cy - direction*length/2 + vy[k]);
+					}
+				}
+				else if (i % 6 == 5)
+				{
+					double radius = uniform(10, 200);
+
+					for (int k = 0; k < amount; k++)
+					{
+						double r = (k % 2) ? 0.35*radius : radius;
+						px[k] = coordinate(cx + r*std::cos(2*M_PI*k/amount));
+						py[k] = coordinate(cy + r*std::sin(2*M_PI*k/amount));
+					}
+				}
+				else
+				{
+					double size = (i % 6 == 3) ? uniform(20, 300) : uniform(1, 20);
+
+					for (int k = 0; k < amount; k++)
+					{
+						px[k] = coordinate(cx + uniform(-size, size));
+						py[k] = coordinate(cy + uniform(-size, size));
+					}
+				}
+			}
+
+			Shape shape(int i) const
+			{
+				Shape s;
+
+				for (int k = elements[i].first; k < elements[i].first + elements[i].second; k++)
+				{
+					s.x.push_back(x[k]);
+					s.y.push_back(y[k]);
+				}
+
+				return s;
+			}
+
+			void aabb(int i, double &xmin, double &xmax, double &ymin, double &ymax) const
+			{
+				Shape s = shape(i);
+
+				xmin = *std::min_element(s.x.begin(), s.x.end());
+				xmax = *std::max_element(s.x.begin(), s.x.end());
+				ymin = *std::min_element(s.y.begin(), s.y.end());
+				ymax = *std::max_element(s.y.begin(), s.y.end());
+			}
+
+			// the AABB boundary boxes of the elements overlap with a positive area (open), or touch (closed)
+			bool aabb_overlap(int i, int k, bool closed) const
+			{
+				double a[4], b[4];
+				aabb(i, a[0], a[1], a[2], a[3]);
+				aabb(k, b[0], b[1], b[2], b[3]);
+
+				if (closed)
+				{
+					return (a[1] >= b[0]) and (b[1] >= a[0]) and (a[3] >= b[2]) and (b[3] >= a[2]);
+				}
+
+				return (a[1] > b[0]) and (b[1] > a[0]) and (a[3] > b[2]) and (b[3] > a[2]);
+			}
+
+			// the elements i and k have to be reported as possibly colliding
+			bool must_collide(int i, int k) const
+			{
+				return aabb_overlap(i, k, false) and ((config.exactOverlap == false) or shapes_overlap(shape(i), shape(k)));
+			}
+
+			int index_of(const std::pair<int, int> &element) const
+			{
+				int i = element.first / slotSize;
+
+				return ((element.first % slotSize == 0) and (i < (int)elements.size()) and (elements[i] == element)) ? i : -1;
+			}
+
+			// the result of a query holds every element once and only elements of the tree
+			bool check_result(const std::vector< std::pair<int, int> > &result, std::vector<char> &reported, const std::string &query)
+			{
+				reported.assign(elements.size(), 0);
+
+				for (const auto &element : result)
+				{
+					int i = index_of(element);
+
+					if ((i < 0) or (live[i] == false) or reported[i])
+					{
+						fail(test, query + " reports an element twice or an element not in the tree");
+						return false;
+					}
+
+					reported[i] = 1;
+				}
+
+				return true;
+			}
+
+			void check_fetch_elements(Tree &tree)
+			{
+				std::vector< std::pair<int, int> > queries;
+				std::vector<char> reported;
+
+				for (int q = 0; q < (int)elements.size(); q += 7)
+				{
+					if (live[q] == false)
+					{
+						continue;
+					}
+
+					queries.push_back(elements[q]);
+
+					std::vector< std::pair<int, int> > result;
+					tree.fetch_elements(elements[q].first, elements[q].second, result);
+
+					if (check_result(result, reported, "fetch_elements") == false)
+					{
+						return;
+					}
+
+					// integer coordinates: an AABB boundary box of zero width or height often lies on the border of a node, i.e., it overlaps the interior of no node (see BoundaryBox::overlaps) and the query is not complete
+					double qxmin, qxmax, qymin, qymax;
+					aabb(q, qxmin, qxmax, qymin, qymax);
+
+					bool complete = (std::is_integral<Scalar>::value == false) or ((qxmin < qxmax) and (qymin < qymax));
+
+					for (int i = 0; complete and (i < (int)elements.size()); i++)
+					{
+						if (live[i] and (reported[i] == false) and must_collide(q, i))
+						{
+							fail(test, "fetch_elements misses an overlapping element");
+							return;
+						}
+					}
+
+					// the set overload returns the same elements
+					std::set< std::pair<int, int> > resultSet = tree.fetch_elements(elements[q].first, elements[q].second);
+
+					if (resultSet != std::set< std::pair<int, int> >(result.begin(), result.end()))
+					{
+						fail(test, "fetch_elements (set) differs from fetch_elements (vector)");
+						return;
+					}
+				}
+
+				// the batch returns the same elements as the single queries (the worker threads are reused across the calls)
+				for (int threadCount : {1, 4, 2})
+				{
+					std::vector< std::vector< std::pair<int, int> > > results;
+					tree.fetch_elements_batch(queries, results, threadCount);
+
+					for (int q = 0; q < (int)queries.size(); q++)
+					{
+						std::vector< std::pair<int, int> > single;
+						tree.fetch_elements(queries[q].first, queries[q].second, single);
+
+						std::sort(single.begin(), single.end());
+						std::sort(results[q].begin(), results[q].end());
+
+						if (single != results[q])
+						{
+							fail(test, "fetch_elements_batch differs from fetch_elements");
+							return;
+						}
+					}
+				}
+			}
+
+			void check_query_aabb(Tree &tree)
+			{
+				std::vector<char> reported;
+
+				for (int q = 0; q < 60; q++)
+				{
+					Scalar xmin = coordinate(uniform(-1000, 900));
+					Scalar ymin = coordinate(uniform(-1000, 900));
+					Scalar xmax = coordinate(xmin + uniform(0, 100));
+					Scalar ymax = coordinate(ymin + uniform(0, 100));
+
+					std::vector< std::pair<int, int> > result;
+					tree.query_aabb(xmin, xmax, ymin, ymax, result);
+
+					if (check_result(result, reported, "query_aabb") == false)
+					{
+						return;
+					}
+
+					Shape box = box_shape(xmin, xmax, ymin, ymax);
+
+					for (int i = 0; i < (int)elements.size(); i++)
+					{
+						if ((live[i] == false) or reported[i])
+						{
+							continue;
+						}
+
+						double exmin, exmax, eymin, eymax;
+						aabb(i, exmin, exmax, eymin, eymax);
+
+						bool touches = (exmax >= xmin) and (exmin <= xmax) and (eymax >= ymin) and (eymin <= ymax);
+
+						if (touches and ((config.exactOverlap == false) or shapes_overlap(shape(i), box)))
+						{
+							fail(test, "query_aabb misses an element touching the box");
+							return;
+						}
+					}
+				}
+			}
+
+			void check_candidate_pairs(Tree &tree)
+			{
+				std::vector<ElementPair> pairs;
+				tree.collect_candidate_pairs(pairs);
+
+				std::set< std::pair<int, int> > reported;
+
+				for (const ElementPair &pair : pairs)
+				{
+					int a = index_of(std::make_pair(pair.startA, pair.amountA));
+					int b = index_of(std::make_pair(pair.startB, pair.amountB));
+
+					if ((a < 0) or (b < 0) or (live[a] == false) or (live[b] == false) or (pair.startA >= pair.startB) or (aabb_overlap(a, b, true) == false) or (reported.insert(std::make_pair(a, b)).second == false))
+					{
+						fail(test, "collect_candidate_pairs reports an invalid or duplicate pair");
+						return;
+					}
+				}
+
+				for (int a = 0; a < (int)elements.size(); a++)
+				{
+					for (int b = a+1; (b < (int)elements.size()) and live[a]; b++)
+					{
+						if (live[b] and (reported.count(std::make_pair(a, b)) == 0) and must_collide(a, b))
+						{
+							fail(test, "collect_candidate_pairs misses an overlapping pair");
+							return;
+						}
+					}
+				}
+			}
+
+			void check_nearest(Tree &tree)
+			{
+				const int k = 5;
+
+				for (int q = 0; q < 40; q++)
+				{
+					double px = coordinate(uniform(-1000, 1000));
+					double py = coordinate(uniform(-1000, 1000));
+
+					std::vector<typename Tree::Nearest> result;
+					tree.fetch_nearest_elements((Scalar)px, (Scalar)py, k, result);
+
+					// distance to the closest point of every element
+					std::vector<double> distances;
+
+					for (int i = 0; i < (int)elements.size(); i++)
+					{
+						if (live[i] == false)
+						{
+							continue;
+						}
+
+						Shape s = shape(i);
+						double best = INFINITY;
+
+						for (int p = 0; p < (int)s.x.size(); p++)
+						{
+							best = std::min(best, std::hypot(s.x[p]-px, s.y[p]-py));
+						}
+
+						distances.push_back(best);
+					}
+
+					std::sort(distances.begin(), distances.end());
+
+					if ((int)result.size() != std::min(k, (int)distances.size()))
+					{
+						fail(test, "fetch_nearest_elements returns the wrong amount of elements");
+						return;
+					}
+
+					for (int i = 0; i < (int)result.size(); i++)
+					{
+						if (std::fabs((double)result[i].distance - distances[i]) > 1e-3*std::max(1.0, distances[i]))
+						{
+							fail(test, "fetch_nearest_elements misses a closer element");
+							return;
+						}
+					}
+				}
+			}
+
+			void check_query_circle(Tree &tree)
+			{
+				std::vector<char> reported;
+
+				for (int q = 0; q < 40; q++)
+				{
+					Scalar cx = coordinate(uniform(-1000, 1000));
+					Scalar cy = coordinate(uniform(-1000, 1000));
+					Real r = (Real)uniform(0, 150);
+
+					std::vector< std::pair<int, int> > result;
+					tree.query_circle(cx, cy, r, result);
+
+					if (check_result(result, reported, "query_circle") == false)
+					{
+						return;
+					}
+
+					// elements touching the circle (the elements close to the circle are left out: rounding of the distance)
+					for (int i = 0; i < (int)elements.size(); i++)
+					{
+						if (live[i] and (reported[i] == false) and (distance_to_shape(shape(i), cx, cy) < r - 1e-3))
+						{
+							fail(test, "query_circle misses an element touching the circle");
+							return;
+						}
+					}
+				}
+			}
+
+			void check_query_polygon(Tree &tree)
+			{
+				std::vector<char> reported;
+
+				for (int q = 0; q < 40; q++)
+				{
+					// triangles and concave quadrilaterals (arrow heads)
+					double cx = uniform(-950, 950);
+					double cy = uniform(-950, 950);
+					double radius = uniform(5, 150);
+					int amount = 3 + q % 2;
+
+					std::vector<Scalar> px, py;
+
+					for (int k = 0; k < amount; k++)
+					{
+						double r = ((amount == 4) and (k == 2)) ? 0.3*radius : radius;
+						double angle = 2*M_PI*k/amount + uniform(0, 0.5);
+
+						px.push_back(coordinate(cx + r*std::cos(angle)));
+						py.push_back(coordinate(cy + r*std::sin(angle)));
+					}
+
+					std::vector< std::pair<int, int> > result;
+					tree.query_polygon(px, py, result);
+
+					if (check_result(result, reported, "query_polygon") == false)
+					{
+						return;
+					}
+
+					Shape polygon;
+					polygon.x.assign(px.begin(), px.end());
+					polygon.y.assign(py.begin(), py.end());
+
+					for (int i = 0; i < (int)elements.size(); i++)
+					{
+						if (live[i] and (reported[i] == false) and shapes_overlap(shape(i), polygon))
+						{
+							fail(test, "query_polygon misses an element touching the polygon");
+							return;
+						}
+					}
+				}
+			}
+
+			// segment_query() reports exactly the elements the segment touches (sorted by distance), raycast() along the segment the same elements
+			void check_segment_query(Tree &tree)
+			{
+				for (int q = 0; q < 40; q++)
+				{
+					// the end points stay clear of the border of the root node (the points of the elements are clamped to it, i.e., the segment would often end exactly on one of their points)
+					Scalar ax = coordinate(uniform(-995, 995));
+					Scalar ay = coordinate(uniform(-995, 995));
+					Scalar bx = coordinate(std::max(-995.0, std::min(995.0, ax + uniform(-300, 300))));
+					Scalar by = coordinate(std::max(-995.0, std::min(995.0, ay + uniform(-300, 300))));
+					double length = std::hypot((double)bx-ax, (double)by-ay);
+
+					std::vector<typename Tree::Hit> hits, firstHit, rayHits;
+					tree.segment_query(ax, ay, bx, by, hits);
+
+					std::vector<char> reported(elements.size(), 0);
+
+					for (int h = 0; h < (int)hits.size(); h++)
+					{
+						int i = index_of(std::make_pair(hits[h].iStart, hits[h].iAmount));
+
+						if ((i < 0) or (live[i] == false) or reported[i] or ((h > 0) and (hits[h].distance < hits[h-1].distance)) or (hits[h].distance < 0) or (hits[h].distance > length + 1e-3*std::max(1.0, length)))
+						{
+							fail(test, "segment_query reports an invalid, duplicate or unsorted hit");
+							return;
+						}
+
+						reported[i] = 1;
+					}
+
+					for (int i = 0; i < (int)elements.size(); i++)
+					{
+						if (live[i] and (reported[i] == false) and segment_hits_shape(shape(i), ax, ay, bx, by))
+						{
+							fail(test, "segment_query misses an element touching the segment");
+							return;
+						}
+					}
+
+					tree.segment_query(ax, ay, bx, by, firstHit, true);
+
+					if ((firstHit.size() != std::min((size_t)1, hits.size())) or ((hits.empty() == false) and (std::fabs((double)firstHit[0].distance - (double)hits[0].distance) > 1e-3*std::max(1.0, length))))
+					{
+						fail(test, "segment_query (first hit only) differs from the closest hit");
+						return;
+					}
+
+					if (length == 0)
+					{
+						continue;
+					}
+
+					tree.raycast(ax, ay, (Real)(((double)bx-ax)/length), (Real)(((double)by-ay)/length), (Real)length, rayHits);
+
+					std::set< std::pair<int, int> > segmentSet, raySet;
+
+					// hits close to the end of the segment may be cut off by the rounding of the direction
+					for (const auto &hit : hits)
+					{
+						if (hit.distance < length - 1e-3*std::max(1.0, length))
+						{
+							segmentSet.insert(std::make_pair(hit.iStart, hit.iAmount));
+						}
+					}
+
+					for (const auto &hit : rayHits)
+					{
+						raySet.insert(std::make_pair(hit.iStart, hit.iAmount));
+					}
+
+					if (std::includes(raySet.begin(), raySet.end(), segmentSet.begin(), segmentSet.end()) == false)
+					{
+						fail(test, "raycast along the segment misses a hit of segment_query");
+						return;
+					}
+				}
+			}
+
+			// Statistics (QUADTREE_STATS): every split turns a leaf node into four leaf nodes and every merge four into one (count_nodes() counts the leaf nodes), every region query is counted. Without QUADTREE_STATS all counters are zero.
+			void check_stats(Tree &tree)
+			{
+				QuadtreeStats before = tree.stats();
+
+#ifdef QUADTREE_STATS
+				if ((uint64_t)tree.count_nodes(&tree) != 1 + 3*(before.subdivisions - before.merges))
+				{
+					fail(test, "stats: the amount of leaf nodes differs from the subdivisions and merges");
+					return;
+				}
+
+				std::vector< std::pair<int, int> > result;
+
+				for (int q = 0; q < 10; q++)
+				{
+					tree.query_aabb(coordinate(-100*q), coordinate(-100*q + 50), coordinate(100*q - 50), coordinate(100*q), result);
+				}
+
+				QuadtreeStats after = tree.stats();
+
+				if ((after.queries != before.queries + 10) or (after.timing[QUADTREE_OP_REGION].calls != before.timing[QUADTREE_OP_REGION].calls + 10) or (after.nodeVisits < before.nodeVisits + 10))
+				{
+					fail(test, "stats: the region queries are not counted");
+				}
+#else
+				if ((before.queries != 0) or (before.nodeVisits != 0) or (before.subdivisions != 0) or (before.timing[QUADTREE_OP_INSERT].calls != 0))
+				{
+					fail(test, "stats: counters without QUADTREE_STATS");
+				}
+#endif
+			}
+
+			// exact overlap tests: a shared element only resides in leaf nodes its polygon touches
+			void check_exact_registration(Tree &tree)
+			{
+				tree.visit_nodes([this](const Tree &node)
+				{
+					for (int k = 0; k < node.amount_shared_elements(); k++)
+					{
+						int i = index_of(node.shared_element(k));
+						const typename Tree::Box &b = node.boundary();
+
+						if ((i >= 0) and (shapes_overlap(shape(i), box_shape((double)b.cx-b.dim, (double)b.cx+b.dim, (double)b.cy-b.dim, (double)b.cy+b.dim)) == false))
+						{
+							fail(test, "exact overlap tests: element resides in a leaf node its polygon does not touch");
+							return;
+						}
+					}
+				});
+			}
+
+			void check(Tree &tree, const std::string &phase)
+			{
+				test = config.name + " (" + phase + ")";
+
+				int amountLive = std::count(live.begin(), live.end(), 1);
+
+				if (tree.count_elements(&tree) != amountLive)
+				{
+					fail(test, "count_elements differs from the amount of inserted elements");
+				}
+
+				check_fetch_elements(tree);
+				check_query_aabb(tree);
+				check_candidate_pairs(tree);
+				check_nearest(tree);
+				check_query_circle(tree);
+				check_query_polygon(tree);
+				check_segment_query(tree);
+				check_stats(tree);
+
+				if (config.exactOverlap)
+				{
+					check_exact_registration(tree);
+				}
+			}
+
+		public:
+			BruteForce(const Config &iConfig, unsigned int seed) : config(iConfig), rng(seed) {}
+
+			void run(int amtElements)
+			{
+				x.assign(amtElements*slotSize, 0);
+				y.assign(amtElements*slotSize, 0);
+				elements.clear();
+				live.assign(amtElements, 0);
+
+				for (int i = 0; i < amtElements; i++)
+				{
+					elements.push_back(std::make_pair(i*slotSize, amount_points(i)));
+					generate(i, &x[i*slotSize], &y[i*slotSize]);
+				}
+
+				Tree tree(std::make_shared<typename Tree::Box>(0, 0, 1024), nullptr, 0, &x, &y, maxElements, maxDepth);
+
+				if (((config.storage != QUADTREE_STORAGE_SHARED) and (tree.set_storage(config.storage, config.looseness) == false)) or (config.exactOverlap and (tree.set_exact_overlap(true) == false)))
+				{
+					fail(config.name, "configuration rejected");
+					return;
+				}
+
+				if (config.elementIndex)
+				{
+					tree.enable_element_index();
+				}
+
+				if (config.nodePool and (tree.enable_node_pool(16) == false))
+				{
+					fail(config.name, "node pool rejected");
+					return;
+				}
+
+				tree.set_deferred_merging(config.deferred);
+
+				// first half: build() or insert(), second half: insert()
+				if (config.build)
+				{
+					std::vector< std::pair<int, int> > first(elements.begin(), elements.begin() + amtElements/2);
+					tree.build(first, 2);
+				}
+				else
+				{
+					for (int i = 0; i < amtElements/2; i++)
+					{
+						tree.insert(elements[i].first, elements[i].second);
+					}
+				}
+
+				std::fill(live.begin(), live.begin() + amtElements/2, 1);
+
+				for (int i = amtElements/2; i < amtElements; i++)
+				{
+					live[i] = tree.insert(elements[i].first, elements[i].second);
+				}
+
+				check(tree, "inserted");
+
+				// churn: delete and relocate elements
+				for (int round = 0; round < 2; round++)
+				{
+					for (int i = round; i < amtElements; i += 6)
+					{
+						if (live[i])
+						{
+							tree.delete_element(elements[i].first, elements[i].second);
+							live[i] = 0;
+						}
+					}
+
+					for (int i = round+1; i < amtElements; i += 4)
+					{
+						if (live[i])
+						{
+							std::vector<Scalar> newX(slotSize), newY(slotSize);
+							generate(i, newX.data(), newY.data());
+							newX.resize(elements[i].second);
+							newY.resize(elements[i].second);
+
+							live[i] = tree.relocate_element(elements[i].first, elements[i].second, &newX, &newY);
+						}
+					}
+
+					if (config.deferred)
+					{
+						tree.collect_garbage();
+					}
+
+					check(tree, "churn " + std::to_string(round+1));
+				}
+			}
+	};
+
+	// the cached AABB boundary box of an element leaving the tree must not be used for a query with a new element in its slot
+	void test_aabb_cache_of_removed_elements()
+	{
+		for (int leave = 0; leave < 2; leave++)
+		{
+			std::string test = leave ? "AABB cache (relocated out of the root node)" : "AABB cache (deleted)";
+
+			if (splits_single_elements(test) == false)
+			{
+				return;
+			}
+
+			std::vector<float> x = {9, 11, 10, -61, -59, -60};
+			std::vector<float> y = {9, 9, 11, -61, -61, -59};
+
+			Quadtree tree(std::make_shared<Quadtree::Box>(0, 0, 100), nullptr, 0, &x, &y, 1, 4);
+			tree.insert(0, 3);
+			tree.insert(3, 3);
+
+			if (leave)
+			{
+				std::vector<float> outsideX = {500, 501, 502};
+				std::vector<float> outsideY = {500, 500, 501};
+
+				if (tree.relocate_element(0, 3, &outsideX, &outsideY))
+				{
+					fail(test, "element outside of the root node inserted");
+				}
+			}
+			else
+			{
+				tree.delete_element(0, 3);
+			}
+
+			// rewrite the slot next to the element (3, 3)
+			x[0] = -60.5; x[1] = -59.5; x[2] = -60;
+			y[0] = -60.5; y[1] = -60.5; y[2] = -59.5;
+
+			std::vector< std::pair<int, int> > result;
+			tree.fetch_elements(0, 3, result);
+
+			if ((result.size() != 1) or (result[0] != std::make_pair(3, 3)))
+			{
+				fail(test, "fetch_elements uses the AABB boundary box of the removed element");
+			}
+		}
+	}
+
+	// exact overlap tests: two shared elements whose polygons do not overlap the leaf node holding the lower left corner of the intersection of their AABBs
+	void test_exact_overlap_pairs()
+	{
+		std::string test = "exact overlap pairs";
+
+		if (splits_single_elements(test) == false)
+		{
+			return;
+		}
+
+		std::vector<float> x = {-19, 21, 21, -18, 21, 21};
+		std::vector<float> y = {21, 21, -19, 21, 21, -18};
+
+		for (int exactOverlap = 0; exactOverlap < 2; exactOverlap++)
+		{
+			Quadtree tree(std::make_shared<Quadtree::Box>(0, 0, 100), nullptr, 0, &x, &y, 1, 1);
+			tree.set_exact_overlap(exactOverlap);
+			tree.insert(0, 3);
+			tree.insert(3, 3);
+
+			std::vector<ElementPair> pairs;
+			tree.collect_candidate_pairs(pairs);
+
+			if ((pairs.size() != 1) or (pairs[0].startA != 0) or (pairs[0].startB != 3))
+			{
+				fail(test, std::string("the pair is ") + (pairs.empty() ? "missing" : "reported more than once") + (exactOverlap ? " (exact overlap tests)" : ""));
+			}
+		}
+	}
+
+	// LinearQuadtree has to return the same elements as Quadtree. Grid aligned coordinates: many points lie on the borders of the nodes, some elements lie partially outside of the root node.
+	void test_linear_quadtree(bool gridAligned)
+	{
+		std::string test = gridAligned ? "linear quadtree (grid aligned)" : "linear quadtree";
+
+		std::mt19937 rng(gridAligned ? 21 : 22);
+		auto coordinate = [&rng, gridAligned](float center, float size)
+		{
+			float v = center + std::uniform_real_distribution<float>(-size, size)(rng);
+
+			return gridAligned ? 8*std::round(v/8) : v;
+		};
+
+		std::vector<float> x, y;
+		std::vector< std::pair<int, int> > elements;
+
+		for (int i = 0; i < 300; i++)
+		{
+			float cx = coordinate(0, 1040);
+			float cy = coordinate(0, 1040);
+			int amount = 1 + i % 4;
+
+			elements.push_back(std::make_pair((int)x.size(), amount));
+
+			for (int k = 0; k < amount; k++)
+			{
+				x.push_back(coordinate(cx, 40));
+				y.push_back(coordinate(cy, 40));
+			}
+		}
+
+		// compares the linear tree with a tree built by inserting all elements of the linear tree (the trees only agree if the tree is not restructured by deletions, i.e., the reference tree is built anew)
+		auto compare = [&](LinearQuadtree &linear, const std::vector<char> &live, const std::string &phase)
+		{
+			Quadtree tree(std::make_shared<Quadtree::Box>(0, 0, 1024), nullptr, 0, &x, &y, maxElements, maxDepth);
+
+			for (int i = 0; i < (int)elements.size(); i++)
+			{
+				if (live[i])
+				{
+					tree.insert(elements[i].first, elements[i].second);
+				}
+			}
+
+			if (linear.count_elements() != tree.count_elements(&tree))
+			{
+				fail(test, phase + ": count_elements differs from Quadtree");
+			}
+
+			for (int i = 0; i < (int)elements.size(); i++)
+			{
+				std::vector< std::pair<int, int> > reference;
+				tree.fetch_elements(elements[i].first, elements[i].second, reference);
+
+				if (linear.fetch_elements(elements[i].first, elements[i].second) != std::set< std::pair<int, int> >(reference.begin(), reference.end()))
+				{
+					fail(test, phase + ": fetch_elements differs from Quadtree");
+					return;
+				}
+			}
+		};
+
+		LinearQuadtree linear(std::make_shared<BoundaryBox>(0, 0, 1024), &x, &y, maxElements, maxDepth);
+		std::vector<char> live(elements.size(), 0);
+
+		for (int i = 0; i < (int)elements.size(); i++)
+		{
+			live[i] = linear.insert(elements[i].first, elements[i].second);
+		}
+
+		compare(linear, live, "inserted");
+
+		// a relocation of a wrong element must not touch the points
+		std::vector<float> newX(7, 0), newY(7, 0);
+		std::vector<float> oldX = x, oldY = y;
+
+		if (linear.relocate_element(elements[0].first, 7, &newX, &newY) or (x != oldX) or (y != oldY))
+		{
+			fail(test, "relocate_element of an element not in the tree changes the points");
+		}
+
+		// delete and relocate elements
+		for (int i = 0; i < (int)elements.size(); i++)
+		{
+			if (live[i] and (i % 5 == 0))
+			{
+				linear.delete_element(elements[i].first, elements[i].second);
+				live[i] = 0;
+			}
+			else if (live[i] and (i % 3 == 0))
+			{
+				newX.resize(elements[i].second);
+				newY.resize(elements[i].second);
+
+				for (int k = 0; k < elements[i].second; k++)
+				{
+					newX[k] = coordinate(x[elements[i].first + k], 64);
+					newY[k] = coordinate(y[elements[i].first + k], 64);
+				}
+
+				live[i] = linear.relocate_element(elements[i].first, elements[i].second, &newX, &newY);
+			}
+		}
+
+		compare(linear, live, "deleted and relocated");
+	}
+
+	std::vector<Config> configs()
+	{
+		return
+		{
+			{"shared", QUADTREE_STORAGE_SHARED, 1, false, false, false, false, false},
+			{"shared, index, deferred merging", QUADTREE_STORAGE_SHARED, 1, false, true, true, false, false},
+			{"shared, node pool", QUADTREE_STORAGE_SHARED, 1, false, false, false, false, true},
+			{"shared, build", QUADTREE_STORAGE_SHARED, 1, false, false, false, true, false},
+			{"enclosing", QUADTREE_STORAGE_ENCLOSING, 1, false, false, false, false, false},
+			{"enclosing, index, deferred merging, build, node pool", QUADTREE_STORAGE_ENCLOSING, 1, false, true, true, true, true},
+			{"loose 2", QUADTREE_STORAGE_LOOSE, 2, false, false, false, false, false},
+			{"loose 2, deferred merging, node pool", QUADTREE_STORAGE_LOOSE, 2, false, false, true, false, true},
+			{"loose 1.5, index, build", QUADTREE_STORAGE_LOOSE, 1.5, false, true, false, true, false},
+			{"exact overlap", QUADTREE_STORAGE_SHARED, 1, true, false, false, false, false},
+			{"exact overlap, index, deferred merging", QUADTREE_STORAGE_SHARED, 1, true, true, true, false, false},
+			{"exact overlap, build, node pool", QUADTREE_STORAGE_SHARED, 1, true, false, false, true, true},
+		};
+	}
+
+	template <typename Scalar>
+	void run_all(const std::string &type, bool exactOverlap)
+	{
+		unsigned int seed = 1;
+
+		for (Config config : configs())
+		{
+			// integer coordinates: touching polygons are common, for which the exact overlap tests may legitimately separate the elements (only checked for floating point coordinates)
+			if (config.exactOverlap and (exactOverlap == false))
+			{
+				continue;
+			}
+
+			config.name = type + ", " + config.name;
+
+			BruteForce<Scalar> bruteForce(config, seed++);
+			bruteForce.run(1200);
+		}
+	}
+}
+
+int main()
+{
+	run_all<float>("float", true);
+	run_all<double>("double", true);
+	run_all<int32_t>("int32_t", false);
+
+	test_aabb_cache_of_removed_elements();
+	test_exact_overlap_pairs();
+	test_linear_quadtree(true);
+	test_linear_quadtree(false);
+
+	if (failures > 0)
+	{
+		std::cout << failures << " failed checks" << std::endl;
+		return 1;
+	}
+
+	std::cout << "all checks passed" << std::endl;
+	return 0;
+}